@@ -0,0 +1,268 @@
+/**
+ * @file midi_codec_bench.c
+ * @brief Host-side microbenchmark for MIDI status classification
+ *
+ * Runs the DIN MIDI parser state machine over a synthetic stream twice:
+ * once with the switch-ladder classifiers that midi_uart.c and usb_midi.c
+ * used before midi_codec existed, once with the midi_codec tables. Prints
+ * parser throughput in bytes per second for both.
+ *
+ * Build and run on the host (from the repository root):
+ *
+ *     cc -O2 -Iinclude bench/midi_codec_bench.c src/midi_codec.c -o midi_codec_bench
+ *     ./midi_codec_bench
+ */
+
+#include "midi_codec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// =============================================================================
+// Benchmark Parameters
+// =============================================================================
+
+#define STREAM_SIZE     (64 * 1024)
+#define ITERATIONS      400
+
+// =============================================================================
+// Legacy Classifiers (switch ladders, as in the original midi_uart.c)
+// =============================================================================
+
+static uint8_t legacy_get_data_byte_count(uint8_t status) {
+    switch (status & 0xF0) {
+        case 0x80:
+        case 0x90:
+        case 0xA0:
+        case 0xB0:
+        case 0xE0:
+            return 2;
+        case 0xC0:
+        case 0xD0:
+            return 1;
+        case 0xF0:
+            switch (status) {
+                case 0xF0: return 255;
+                case 0xF1:
+                case 0xF3: return 1;
+                case 0xF2: return 2;
+                default:   return 0;
+            }
+        default:
+            return 0;
+    }
+}
+
+static midi_message_type_t legacy_get_message_type(uint8_t status) {
+    switch (status & 0xF0) {
+        case 0x80: return MIDI_MSG_NOTE_OFF;
+        case 0x90: return MIDI_MSG_NOTE_ON;
+        case 0xA0: return MIDI_MSG_POLY_PRESSURE;
+        case 0xB0: return MIDI_MSG_CONTROL_CHANGE;
+        case 0xC0: return MIDI_MSG_PROGRAM_CHANGE;
+        case 0xD0: return MIDI_MSG_CHANNEL_PRESSURE;
+        case 0xE0: return MIDI_MSG_PITCH_BEND;
+        case 0xF0:
+            switch (status) {
+                case 0xF0: return MIDI_MSG_SYSEX_START;
+                case 0xF1: return MIDI_MSG_MTC_QUARTER;
+                case 0xF2: return MIDI_MSG_SONG_POSITION;
+                case 0xF3: return MIDI_MSG_SONG_SELECT;
+                case 0xF6: return MIDI_MSG_TUNE_REQUEST;
+                case 0xF7: return MIDI_MSG_SYSEX_END;
+                case 0xF8: return MIDI_MSG_CLOCK;
+                case 0xFA: return MIDI_MSG_START;
+                case 0xFB: return MIDI_MSG_CONTINUE;
+                case 0xFC: return MIDI_MSG_STOP;
+                case 0xFE: return MIDI_MSG_ACTIVE_SENSING;
+                case 0xFF: return MIDI_MSG_SYSTEM_RESET;
+                default:   return MIDI_MSG_NONE;
+            }
+        default:
+            return MIDI_MSG_NONE;
+    }
+}
+
+static inline bool legacy_is_realtime(uint8_t byte) {
+    return byte >= 0xF8;
+}
+
+// =============================================================================
+// Parser (same state machine as midi_uart.c, classifier is a parameter)
+// =============================================================================
+
+typedef enum {
+    PARSER_IDLE,
+    PARSER_DATA1,
+    PARSER_DATA2,
+    PARSER_SYSEX,
+} parser_state_t;
+
+typedef struct {
+    parser_state_t state;
+    uint8_t running_status;
+    uint8_t expected;
+    midi_message_t msg;
+    uint32_t checksum;      // Consumes every message so nothing is optimised out
+} bench_parser_t;
+
+static inline void bench_dispatch(bench_parser_t *p, const midi_message_t *msg) {
+    p->checksum = p->checksum * 31u + (uint32_t)msg->type + msg->data1 + msg->data2;
+}
+
+#define DEFINE_PARSER(name, IS_REALTIME, GET_TYPE, GET_LENGTH)                  \
+static void name(bench_parser_t *p, uint8_t byte) {                             \
+    if (IS_REALTIME(byte)) {                                                    \
+        midi_message_t rt = { .type = GET_TYPE(byte), .raw = {byte, 0, 0},      \
+                              .length = 1 };                                    \
+        bench_dispatch(p, &rt);                                                 \
+        return;                                                                 \
+    }                                                                           \
+    if (byte & 0x80) {                                                          \
+        p->running_status = ((byte & 0xF0) == 0xF0) ? 0 : byte;                 \
+        p->expected = GET_LENGTH(byte);                                         \
+        if (byte == 0xF0) { p->state = PARSER_SYSEX; return; }                  \
+        if (byte == 0xF7) { p->state = PARSER_IDLE; return; }                   \
+        p->msg.type = GET_TYPE(byte);                                           \
+        p->msg.channel = byte & 0x0F;                                           \
+        p->msg.raw[0] = byte;                                                   \
+        p->msg.length = 1;                                                      \
+        if (p->expected == 0) {                                                 \
+            bench_dispatch(p, &p->msg);                                         \
+            p->state = PARSER_IDLE;                                             \
+        } else {                                                                \
+            p->state = PARSER_DATA1;                                            \
+        }                                                                       \
+        return;                                                                 \
+    }                                                                           \
+    if (p->state == PARSER_IDLE && p->running_status != 0) {                    \
+        p->expected = GET_LENGTH(p->running_status);                            \
+        p->msg.type = GET_TYPE(p->running_status);                              \
+        p->msg.channel = p->running_status & 0x0F;                              \
+        p->msg.raw[0] = p->running_status;                                      \
+        p->msg.length = 1;                                                      \
+        p->state = PARSER_DATA1;                                                \
+    }                                                                           \
+    if (p->state == PARSER_DATA1) {                                             \
+        p->msg.data1 = byte;                                                    \
+        p->msg.raw[1] = byte;                                                   \
+        p->msg.length = 2;                                                      \
+        if (p->expected == 1) {                                                 \
+            p->msg.data2 = 0;                                                   \
+            bench_dispatch(p, &p->msg);                                         \
+            p->state = PARSER_IDLE;                                             \
+        } else {                                                                \
+            p->state = PARSER_DATA2;                                            \
+        }                                                                       \
+    } else if (p->state == PARSER_DATA2) {                                      \
+        p->msg.data2 = byte;                                                    \
+        p->msg.raw[2] = byte;                                                   \
+        p->msg.length = 3;                                                      \
+        bench_dispatch(p, &p->msg);                                             \
+        p->state = PARSER_IDLE;                                                 \
+    }                                                                           \
+}
+
+DEFINE_PARSER(parse_byte_legacy, legacy_is_realtime, legacy_get_message_type,
+              legacy_get_data_byte_count)
+DEFINE_PARSER(parse_byte_table, midi_codec_is_realtime, midi_codec_get_type,
+              midi_codec_get_data_length)
+
+// =============================================================================
+// Stream Generation
+// =============================================================================
+
+/**
+ * @brief Fill a buffer with a plausible performance stream
+ *
+ * Notes, CC sweeps with running status, pitch bend, program changes,
+ * interleaved clock bytes and the occasional short SysEx.
+ */
+static size_t generate_stream(uint8_t *buf, size_t size) {
+    size_t n = 0;
+    uint32_t seed = 0x12345678u;
+
+    while (n + 16 < size) {
+        seed = seed * 1664525u + 1013904223u;
+        uint8_t ch = (seed >> 8) & 0x0F;
+        uint8_t v = (seed >> 16) & 0x7F;
+
+        switch ((seed >> 28) & 0x07) {
+            case 0:
+            case 1:
+                buf[n++] = 0x90 | ch; buf[n++] = v; buf[n++] = 100;
+                buf[n++] = 0x80 | ch; buf[n++] = v; buf[n++] = 0;
+                break;
+            case 2:
+            case 3:
+                // CC sweep using running status
+                buf[n++] = 0xB0 | ch;
+                for (int i = 0; i < 4; i++) {
+                    buf[n++] = 74; buf[n++] = (v + i) & 0x7F;
+                }
+                break;
+            case 4:
+                buf[n++] = 0xE0 | ch; buf[n++] = v; buf[n++] = 0x40;
+                break;
+            case 5:
+                buf[n++] = 0xC0 | ch; buf[n++] = v;
+                break;
+            case 6:
+                buf[n++] = 0xF8;
+                break;
+            default:
+                buf[n++] = 0xF0; buf[n++] = 0x7D; buf[n++] = v; buf[n++] = 0xF7;
+                break;
+        }
+    }
+    return n;
+}
+
+// =============================================================================
+// Timing
+// =============================================================================
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+typedef void (*parse_fn_t)(bench_parser_t *p, uint8_t byte);
+
+static double run(const char *label, parse_fn_t parse, const uint8_t *buf, size_t len) {
+    bench_parser_t p = {0};
+
+    double start = now_seconds();
+    for (int it = 0; it < ITERATIONS; it++) {
+        for (size_t i = 0; i < len; i++) {
+            parse(&p, buf[i]);
+        }
+    }
+    double elapsed = now_seconds() - start;
+
+    double bytes_per_sec = (double)len * ITERATIONS / elapsed;
+    printf("%-8s %10.1f MB/s  (checksum %08x)\n", label, bytes_per_sec / 1e6, p.checksum);
+    return bytes_per_sec;
+}
+
+// =============================================================================
+// Main
+// =============================================================================
+
+int main(void) {
+    uint8_t *buf = malloc(STREAM_SIZE);
+    if (buf == NULL) {
+        return 1;
+    }
+    size_t len = generate_stream(buf, STREAM_SIZE);
+
+    printf("MIDI parser throughput, %zu-byte stream x %d\n", len, ITERATIONS);
+    double before = run("switch", parse_byte_legacy, buf, len);
+    double after = run("table", parse_byte_table, buf, len);
+    printf("speedup  %10.2fx\n", after / before);
+
+    free(buf);
+    return 0;
+}
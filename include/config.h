@@ -32,6 +32,19 @@
 // GB_SO (Serial Out from Game Boy) - input to Pico
 #define PIN_GB_SO           4
 
+// Number of Game Boys driven at once, one PIO state machine each (1-4)
+#ifndef GB_LINK_PORT_COUNT
+#define GB_LINK_PORT_COUNT  1
+#endif
+
+// Pins of each link port as { SI, SC, SO }; port 0 is the one above
+#define GB_LINK_PORT_PINS   {                       \
+    { PIN_GB_SI, PIN_GB_SC, PIN_GB_SO },            \
+    { 5, 6, 7 },                                    \
+    { 14, 15, 16 },                                 \
+    { 17, 18, 19 },                                 \
+}
+
 // =============================================================================
 // MIDI Interface Pins (UART1)
 // =============================================================================
@@ -47,6 +60,48 @@
 #define MIDI_UART_ID        uart1
 #define MIDI_BAUD_RATE      31250
 
+// MIDI UART receive backend
+// - IRQ: UART RX interrupt copies each byte into the ring buffer
+// - DMA: a DMA channel in ring mode writes straight into the ring buffer,
+//        midi_uart_process() reads the head from the DMA write address
+#define MIDI_RX_BACKEND_IRQ     0
+#define MIDI_RX_BACKEND_DMA     1
+
+#ifndef MIDI_RX_BACKEND
+#define MIDI_RX_BACKEND         MIDI_RX_BACKEND_IRQ
+#endif
+
+// Where the DIN MIDI parser runs
+// - 0: RX interrupts only fill the byte rings, midi_uart_process() parses
+// - 1: the parser runs inside the RX interrupts and finished messages go
+//      straight into the message queue, so input latency no longer depends
+//      on how often the main loop calls midi_uart_process(). All midi_uart
+//      callbacks then run in interrupt context. Requires MIDI_RX_BACKEND_IRQ.
+#ifndef MIDI_RX_PARSE_IN_ISR
+#define MIDI_RX_PARSE_IN_ISR    0
+#endif
+
+// Additional DIN MIDI inputs, received by PIO UART state machines
+// Port 0 is always the UART input on PIN_MIDI_RX; the pins listed here
+// become ports 1, 2, ... in order (each needs its own optocoupler): GP10
+// for MIDI IN 2, GP11 for IN 3, GP12 for IN 4, GP13 for IN 5.
+// Up to 4, limited by the state machines of one PIO block. Off by default
+// (0): no pins, pio1 state machines or PIO IRQ are claimed.
+#ifndef MIDI_PIO_RX_PORT_COUNT
+#define MIDI_PIO_RX_PORT_COUNT  0
+#endif
+#define MIDI_PIO_RX_PINS        { 10, 11, 12, 13 }
+
+// PIO block for the extra inputs (the GB link takes pio0 first)
+#define MIDI_PIO_RX_PIO         pio1
+
+// Total number of DIN MIDI inputs
+#define MIDI_PORT_COUNT         (1 + MIDI_PIO_RX_PORT_COUNT)
+
+// Omit repeated channel status bytes on MIDI OUT by default (1 = enabled)
+// Can be changed at runtime with midi_uart_set_tx_running_status()
+#define MIDI_TX_RUNNING_STATUS  0
+
 // =============================================================================
 // LED Indicator
 // =============================================================================
@@ -57,24 +112,118 @@
 // Timing Configuration
 // =============================================================================
 // mGB expects ~500µs delay between bytes (from Arduinoboy reference)
+// Enforced by the GB link PIO program (gb_link_set_byte_gap_us())
 #define MGB_INTER_BYTE_DELAY_US     500
 
+// Longest a message may wait in the mGB output stage while higher priority
+// classes (notes > program changes > controllers) keep it busy (µs)
+#define MGB_STARVATION_BOUND_US     20000
+
+// Running status on the GB link (mode_mgb_config_t.running_status), off by
+// default since it depends on the target ROM's parser. The status byte is
+// sent again after MGB_RUNNING_STATUS_REFRESH messages without it and
+// whenever the link was quiet for MGB_RUNNING_STATUS_IDLE_US.
+#define MGB_RUNNING_STATUS          0
+#define MGB_RUNNING_STATUS_REFRESH  16
+#define MGB_RUNNING_STATUS_IDLE_US  100000
+
+// Forward DIN/USB MIDI real-time bytes to the GB link in mGB mode
+// (mode_mgb_config_t.forward_realtime), off by default as mGB ignores them
+#define MGB_FORWARD_REALTIME        0
+
+// GB link inter-byte gap until a mode sets its own
+#define GB_LINK_DEFAULT_GAP_US      1000
+
 // Game Boy link clock period (approx 122µs for ~8kHz clock)
 // The PIO will handle precise timing
 #define GB_LINK_BIT_PERIOD_US       8
 
+// Byte sent in slave role when the Game Boy clocks and nothing is queued
+#define GB_LINK_SLAVE_FILL_BYTE     0x00
+
+// Game Boy link bit clock until a profile is selected (Hz)
+// The GB runs at ~8192 Hz internally, but mGB is flexible
+// Arduinoboy uses slightly slower timing with delays
+#define GB_LINK_DEFAULT_CLOCK_HZ    8000
+
+// Range accepted by gb_link_set_clock_hz() (Hz)
+#define GB_LINK_MIN_CLOCK_HZ        1000
+#define GB_LINK_MAX_CLOCK_HZ        1000000
+
+// Times the test pattern is sent at each rate by gb_link_calibrate()
+#define GB_LINK_CALIBRATION_PASSES  4
+
+// Loopback self-test (link_selftest.c, SI jumpered to SO)
+// Run the sweep on port 0 at startup instead of going straight to mGB
+#ifndef LINK_SELFTEST_AT_BOOT
+#define LINK_SELFTEST_AT_BOOT       0
+#endif
+
+// Clock rates (Hz) and gaps (µs) swept, bytes sent at each setting, and how
+// long without an echo before the rest of a setting counts as lost
+#define LINK_SELFTEST_CLOCKS_HZ     { 8000, 16384, 65536, 262144, 1000000 }
+#define LINK_SELFTEST_GAPS_US       { 1000, 500, 100, 0 }
+#define LINK_SELFTEST_BYTES         1024
+#define LINK_SELFTEST_TIMEOUT_MS    50
+
 // LED blink duration for activity indication
 #define LED_BLINK_DURATION_MS       50
 
 // =============================================================================
 // Buffer Sizes
 // =============================================================================
-// MIDI receive ring buffer size (must be power of 2)
+// MIDI receive ring buffer size, per input port (must be power of 2)
 #define MIDI_RX_BUFFER_SIZE         256
 
-// GB link transmit queue size (must be power of 2)
+// Parsed MIDI message queue depth (must be power of 2)
+// Absorbs bursts such as chords or dense CC sweeps between main loop passes
+#define MIDI_MSG_QUEUE_SIZE         32
+
+// Real-time byte queue depth, fed straight from the UART ISR (must be power of 2)
+#define MIDI_RT_QUEUE_SIZE          16
+
+// MIDI OUT transmit ring buffer size (must be power of 2)
+#define MIDI_TX_BUFFER_SIZE         256
+
+// mGB merge queue depth in messages, per input source (DIN, USB) (must be
+// power of 2); holds what the link cannot take yet
+#define MGB_SOURCE_QUEUE_SIZE       32
+
+// mGB DIN to USB thru queue depth in messages and SysEx chunks (must be
+// power of 2); filled by the midi_uart callbacks, sent by the main loop
+#define MGB_USB_THRU_QUEUE_SIZE     32
+
+// mGB real-time byte queue depth, per link port (must be power of 2)
+#define MGB_RT_QUEUE_SIZE           8
+
+// mGB output queue depth in messages, per link port and priority class
+// (must be power of 2)
+// Released into the GB link TX ring by a hardware alarm, one message per
+// port at a time as the link drains
+#define MGB_OUT_QUEUE_SIZE          32
+
+// GB link transmit ring size, drained into the PIO by DMA (must be power of 2)
 #define GB_TX_QUEUE_SIZE            64
 
+// GB link receive ring size (must be power of 2)
+#define GB_RX_BUFFER_SIZE           64
+
+// Drain the GB link RX FIFO into the receive ring with DMA (1) or read the
+// 4-entry PIO FIFO directly (0)
+#ifndef GB_LINK_RX_DMA
+#define GB_LINK_RX_DMA              1
+#endif
+
+// Record every byte sent on the GB link with its queue and wire times
+// (gb_link_trace_read(), dumped over USB by mGB mode). Costs an interrupt
+// per byte in master role; compiled out entirely when 0.
+#ifndef GB_LINK_TRACE
+#define GB_LINK_TRACE               0
+#endif
+
+// GB link trace entries kept per port (must be power of 2)
+#define GB_LINK_TRACE_SIZE          256
+
 // =============================================================================
 // Operating Modes
 // =============================================================================
@@ -110,4 +259,21 @@ typedef enum {
     #define DEBUG_PRINT(...)    ((void)0)
 #endif
 
+// Link timing benchmark on port 0 at startup (sends a Note Off to whatever
+// is attached, so only for a bench setup)
+#ifndef LINK_CAPTURE_AT_BOOT
+#define LINK_CAPTURE_AT_BOOT        0
+#endif
+
+// Link timing capture (link_capture.c), built for the boot benchmark or on
+// request; takes the capture buffer below out of RAM
+#ifndef LINK_CAPTURE_ENABLED
+#define LINK_CAPTURE_ENABLED        LINK_CAPTURE_AT_BOOT
+#endif
+
+// Capture sample rate (Hz) and buffer size (32-bit words, 8 samples each)
+// Default: 1 µs resolution over ~32 ms, 16 KB of RAM
+#define LINK_CAPTURE_SAMPLE_HZ      1000000
+#define LINK_CAPTURE_BUFFER_WORDS   4096
+
 #endif // MIDIBOY_CONFIG_H
@@ -10,8 +10,14 @@
  * - SI (Serial In): Data to Game Boy  
  * - SO (Serial Out): Data from Game Boy
  * 
- * For mGB mode, we only need TX (sending MIDI to Game Boy).
- * Future modes (LSDJ MI.OUT) will add RX capability.
+ * The link is full duplex: each byte sent also clocks in one byte from
+ * the Game Boy, available through gb_link_receive_byte(). mGB mode only
+ * sends; modes where data flows from the Game Boy (LSDJ MI.OUT) read it.
+ * 
+ * Up to GB_LINK_PORT_COUNT Game Boys can be connected (pins in
+ * GB_LINK_PORT_PINS). Every function below except init/deinit takes the
+ * port index (0 = the link on PIN_GB_SI/SC/SO); each port has its own
+ * queue, clock, pacing, role and statistics.
  */
 
 #ifndef GB_LINK_H
@@ -20,6 +26,56 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// =============================================================================
+// Clock Profiles
+// =============================================================================
+
+/**
+ * @brief Named link clock rates for different targets
+ */
+typedef enum {
+    GB_LINK_PROFILE_DMG_MGB = 0,        // mGB on DMG, Arduinoboy timing
+    GB_LINK_PROFILE_CGB_DOUBLE_SPEED,   // Targets running CGB double speed
+    GB_LINK_PROFILE_CALIBRATED,         // Result of gb_link_calibrate()
+    GB_LINK_PROFILE_COUNT
+} gb_link_profile_t;
+
+/**
+ * @brief Which side drives the link clock (SC)
+ */
+typedef enum {
+    GB_LINK_ROLE_MASTER = 0,    // MIDIBoy clocks the Game Boy (mGB, sync out)
+    GB_LINK_ROLE_SLAVE,         // The Game Boy clocks us (LSDJ master sync, MI.OUT)
+    GB_LINK_ROLE_COUNT
+} gb_link_role_t;
+
+/**
+ * @brief Callback run when a port goes idle
+ * 
+ * Called from interrupt context once the last byte queued on the port
+ * and its gap have been clocked out.
+ * 
+ * @param port Port that went idle
+ */
+typedef void (*gb_link_idle_callback_t)(uint8_t port);
+
+/**
+ * @brief Clock profile description
+ */
+typedef struct {
+    const char *name;
+    uint32_t clock_hz;      // Bit clock on SC
+} gb_link_clock_profile_t;
+
+/**
+ * @brief One byte recorded by the transmit trace (GB_LINK_TRACE)
+ */
+typedef struct {
+    uint32_t queued_us;     // Time the byte was queued (timer, µs)
+    uint32_t wire_us;       // Time the byte and its gap were clocked out, 0 if not (yet)
+    uint8_t data;
+} gb_link_trace_entry_t;
+
 // =============================================================================
 // Initialization
 // =============================================================================
@@ -27,20 +83,30 @@
 /**
  * @brief Initialize the Game Boy link interface
  * 
- * Sets up PIO for transmitting to the Game Boy.
- * Must be called before any other gb_link functions.
+ * Starts every configured port, taking state machines on pio0 first and
+ * then pio1; the programs are loaded once per PIO block. Ports beyond the
+ * available PIO or DMA resources are left out. Must be called before any
+ * other gb_link functions (settings made earlier are applied here).
  * 
- * @return true if initialization successful
+ * @return true if at least the first port started
  */
 bool gb_link_init(void);
 
 /**
  * @brief Deinitialize the Game Boy link interface
  * 
- * Releases PIO resources. Call when switching modes that don't use GB link.
+ * Waits for queued bytes to be sent, then releases PIO resources. Call
+ * when switching modes that don't use GB link.
  */
 void gb_link_deinit(void);
 
+/**
+ * @brief Get the number of running ports
+ * 
+ * @return Ports 0 .. count-1 are usable (0 before gb_link_init())
+ */
+uint8_t gb_link_get_port_count(void);
+
 // =============================================================================
 // Transmission (Master → Game Boy)
 // =============================================================================
@@ -48,42 +114,262 @@ void gb_link_deinit(void);
 /**
  * @brief Send a byte to the Game Boy (non-blocking)
  * 
- * Queues a byte for transmission via PIO. Returns immediately.
+ * Queues a byte in the TX ring (GB_TX_QUEUE_SIZE bytes), which DMA feeds
+ * to the PIO in the background. Returns immediately.
  * 
+ * @param port Port index
  * @param data Byte to send
  * @return true if byte was queued, false if TX queue is full
  */
-bool gb_link_send_byte(uint8_t data);
+bool gb_link_send_byte(uint8_t port, uint8_t data);
+
+/**
+ * @brief Send several bytes to the Game Boy (non-blocking)
+ * 
+ * The bytes are queued whole or not at all, so a MIDI message is never
+ * split by a full queue.
+ * 
+ * @param port Port index
+ * @param data Bytes to send
+ * @param length Number of bytes
+ * @return true if queued, false if there was not enough room
+ */
+bool gb_link_send_bytes(uint8_t port, const uint8_t *data, uint16_t length);
 
 /**
  * @brief Send a byte to the Game Boy (blocking)
  * 
  * Blocks until the byte can be queued for transmission.
  * 
+ * @param port Port index
  * @param data Byte to send
  */
-void gb_link_send_byte_blocking(uint8_t data);
+void gb_link_send_byte_blocking(uint8_t port, uint8_t data);
 
 /**
  * @brief Check if the TX queue has space
  * 
+ * @param port Port index
  * @return true if at least one byte can be queued
  */
-bool gb_link_tx_ready(void);
+bool gb_link_tx_ready(uint8_t port);
+
+/**
+ * @brief Get free space in the TX queue
+ * 
+ * @param port Port index
+ * @return Number of bytes that can be queued
+ */
+uint16_t gb_link_tx_free(uint8_t port);
 
 /**
  * @brief Get number of bytes waiting in TX queue
  * 
- * @return Number of pending bytes
+ * @param port Port index
+ * @return Number of pending bytes (ring plus PIO FIFO)
  */
-uint8_t gb_link_tx_pending(void);
+uint16_t gb_link_tx_pending(uint8_t port);
 
 /**
  * @brief Flush the TX queue
  * 
- * Waits until all queued bytes have been transmitted.
+ * Waits until all queued bytes and the gap after the last one have been
+ * clocked out. The core sleeps until the PIO signals idle. Must not be
+ * called from interrupt context. In slave role, waits until the Game Boy
+ * has clocked every queued byte out.
+ * 
+ * @param port Port index
+ */
+void gb_link_tx_flush(uint8_t port);
+
+/**
+ * @brief Check if the link is idle
+ * 
+ * @param port Port index
+ * @return true if nothing is queued and the last byte and its gap are done
+ */
+bool gb_link_is_idle(uint8_t port);
+
+/**
+ * @brief Set the callback for the link going idle
+ * 
+ * Runs in interrupt context each time the queue has fully drained onto
+ * the wire, so callers can chain work without polling.
+ * 
+ * @param port Port index
+ * @param callback Function to call, or NULL to disable
+ */
+void gb_link_set_idle_callback(uint8_t port, gb_link_idle_callback_t callback);
+
+/**
+ * @brief Set the gap between consecutive bytes
+ * 
+ * The PIO program holds the clock HIGH for this long after every byte,
+ * giving the target ROM time to process it, so callers can queue bytes
+ * back to back without any timing of their own. Tune per target ROM
+ * (mGB: MGB_INTER_BYTE_DELAY_US). Resolution is one PIO cycle, 1/16 of
+ * a bit (~8µs at 8 kHz).
+ * 
+ * If bytes are queued, waits for them to be sent before changing the gap.
+ * 
+ * @param port Port index
+ * @param gap_us Gap in microseconds
+ */
+void gb_link_set_byte_gap_us(uint8_t port, uint32_t gap_us);
+
+/**
+ * @brief Get the gap between consecutive bytes
+ * 
+ * @param port Port index
+ * @return Gap in microseconds
+ */
+uint32_t gb_link_get_byte_gap_us(uint8_t port);
+
+// =============================================================================
+// Clock Rate
+// =============================================================================
+
+/**
+ * @brief Set the link bit clock
+ * 
+ * Changes the PIO clock divider without reloading the program. If bytes
+ * are queued, waits for them to be sent first. The byte gap keeps its
+ * length in µs. Clamped to GB_LINK_MIN_CLOCK_HZ..GB_LINK_MAX_CLOCK_HZ.
+ * 
+ * @param port Port index
+ * @param clock_hz Bit clock in Hz
+ */
+void gb_link_set_clock_hz(uint8_t port, uint32_t clock_hz);
+
+/**
+ * @brief Get the link bit clock
+ * 
+ * @param port Port index
+ * @return Bit clock in Hz
+ */
+uint32_t gb_link_get_clock_hz(uint8_t port);
+
+/**
+ * @brief Switch to a named clock profile
+ * 
+ * @param port Port index
+ * @param profile Profile to use
+ * @return true if the profile exists
+ */
+bool gb_link_select_profile(uint8_t port, gb_link_profile_t profile);
+
+/**
+ * @brief Get the profile selected last
+ * 
+ * @param port Port index
+ * @return Active profile (gb_link_set_clock_hz() does not change it)
+ */
+gb_link_profile_t gb_link_get_profile(uint8_t port);
+
+/**
+ * @brief Get the name and rate of a profile
+ * 
+ * @param profile Profile to look up
+ * @return Profile description, or NULL if it does not exist
+ */
+const gb_link_clock_profile_t *gb_link_get_profile_info(gb_link_profile_t profile);
+
+/**
+ * @brief Find the fastest clock the link handles reliably
+ * 
+ * Sends a test pattern GB_LINK_CALIBRATION_PASSES times at rates rising
+ * from min_hz in 25% steps up to max_hz, and checks the bytes echoed on
+ * SO. Either an SI-SO loopback plug or a target that echoes its shift
+ * register (the received byte comes back one byte later) will do. The
+ * last rate that passed is stored in GB_LINK_PROFILE_CALIBRATED, which
+ * is then selected on this port. The profile is shared by all ports, so
+ * the latest calibration wins.
+ * 
+ * The pattern goes out on SI, so a target such as mGB will act on it;
+ * run this with a loopback plug or an echoing test ROM. Blocks until
+ * done; discards any received bytes not yet read.
+ * 
+ * @param port Port index
+ * @param min_hz First rate to try
+ * @param max_hz Highest rate to try
+ * @return Calibrated rate in Hz, or 0 if min_hz already failed (the
+ *         previous rate is then restored)
+ */
+uint32_t gb_link_calibrate(uint8_t port, uint32_t min_hz, uint32_t max_hz);
+
+// =============================================================================
+// Clock Role
+// =============================================================================
+
+/**
+ * @brief Switch between driving and following the link clock
+ * 
+ * Both PIO programs stay loaded, so this only restarts the state machine
+ * on the same pins. Leaving master role first waits for queued bytes;
+ * leaving slave role drops bytes the Game Boy has not clocked out yet.
+ * Unread received bytes are dropped either way. SC is switched from
+ * output to input or back, so change roles before the Game Boy starts
+ * driving the clock and while it is not mid-byte.
+ * 
+ * In slave role the clock rate, byte gap and idle notification do not
+ * apply; they take effect again on returning to master role.
+ * 
+ * @param port Port index
+ * @param role New role
+ * @return true if the role exists
+ */
+bool gb_link_set_role(uint8_t port, gb_link_role_t role);
+
+/**
+ * @brief Get the current clock role
+ * 
+ * @param port Port index
+ * @return Current role
+ */
+gb_link_role_t gb_link_get_role(uint8_t port);
+
+// =============================================================================
+// Reception (Game Boy → Master)
+// =============================================================================
+
+/**
+ * @brief Check if a byte received from the Game Boy is waiting
+ * 
+ * The master drives the clock, so a byte is only received while one is
+ * being sent. Send a dummy byte (e.g. 0x00) to poll the Game Boy.
+ * 
+ * @param port Port index
+ * @return true if gb_link_receive_byte() will return a byte
  */
-void gb_link_tx_flush(void);
+bool gb_link_rx_available(uint8_t port);
+
+/**
+ * @brief Get the next byte received from the Game Boy (non-blocking)
+ * 
+ * Bytes come out in the order they were clocked in, one per byte sent.
+ * With GB_LINK_RX_DMA they are buffered in a ring of GB_RX_BUFFER_SIZE
+ * bytes; otherwise only the 4-entry PIO RX FIFO holds them, and further
+ * bytes are dropped until it is read.
+ * 
+ * @param port Port index
+ * @param data Where to store the byte
+ * @return true if a byte was available
+ */
+bool gb_link_receive_byte(uint8_t port, uint8_t *data);
+
+/**
+ * @brief Get the next received byte with its completion time
+ * 
+ * In slave role each byte is stamped (timer_hw->timerawl) when its last
+ * bit was clocked in, for sync modes that follow the Game Boy's timing.
+ * In master role the link clock is ours and time_us is set to 0.
+ * 
+ * @param port Port index
+ * @param data Where to store the byte
+ * @param time_us Where to store the completion time in µs
+ * @return true if a byte was available
+ */
+bool gb_link_receive_byte_timed(uint8_t port, uint8_t *data, uint32_t *time_us);
 
 // =============================================================================
 // Statistics (for debugging)
@@ -92,13 +378,59 @@ void gb_link_tx_flush(void);
 /**
  * @brief Get total bytes transmitted
  * 
- * @return Count of bytes sent since initialization
+ * @param port Port index
+ * @return Count of bytes queued for sending since initialization
+ */
+uint32_t gb_link_get_tx_count(uint8_t port);
+
+/**
+ * @brief Get total bytes received from the Game Boy
+ * 
+ * @param port Port index
+ * @return Count of bytes clocked in since initialization
  */
-uint32_t gb_link_get_tx_count(void);
+uint32_t gb_link_get_rx_count(uint8_t port);
 
 /**
- * @brief Reset transmission statistics
+ * @brief Get count of receive ring overruns
+ * 
+ * Counts the times unread received bytes were discarded because the ring
+ * filled up (GB_LINK_RX_DMA only).
+ * 
+ * @param port Port index
+ * @return Overrun count
+ */
+uint32_t gb_link_get_rx_overrun_count(uint8_t port);
+
+/**
+ * @brief Reset transmission and reception statistics
  */
 void gb_link_reset_stats(void);
 
+// =============================================================================
+// Transmit Trace
+// =============================================================================
+
+/**
+ * @brief Copy a port's transmit trace, oldest byte first
+ * 
+ * With GB_LINK_TRACE set, the last GB_LINK_TRACE_SIZE bytes queued on
+ * each port are kept with their queue and wire times. Wire times are only
+ * taken in master role. Without GB_LINK_TRACE this always returns 0.
+ * 
+ * @param port Port index
+ * @param entries Where to copy the entries
+ * @param max_entries Size of the entries array
+ * @return Number of entries copied
+ */
+uint16_t gb_link_trace_read(uint8_t port, gb_link_trace_entry_t *entries,
+                            uint16_t max_entries);
+
+/**
+ * @brief Forget the bytes traced so far on a port
+ * 
+ * @param port Port index
+ */
+void gb_link_trace_clear(uint8_t port);
+
 #endif // GB_LINK_H
@@ -0,0 +1,120 @@
+/**
+ * @file link_capture.h
+ * @brief On-device logic analyzer for Game Boy link timing
+ * 
+ * Debug aid that samples the SI, SC and SO pins of a link port with a
+ * spare PIO state machine and DMA, then measures what was really on the
+ * wire: clock periods, low times, data setup before each rising edge and
+ * gaps between bytes, with min/avg/max so jitter shows up. Running it
+ * after a change to the link code gives a repeatable timing benchmark.
+ * 
+ * Usage:
+ * 1. link_capture_start() arms the capture (it triggers on SC going low)
+ * 2. Send some bytes on the port
+ * 3. Wait for link_capture_is_done()
+ * 4. link_capture_analyze() decodes the samples and frees the resources
+ * 
+ * Built when LINK_CAPTURE_ENABLED is set; LINK_CAPTURE_AT_BOOT also runs
+ * link_capture_benchmark() on port 0 at startup.
+ */
+
+#ifndef LINK_CAPTURE_H
+#define LINK_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// =============================================================================
+// Results
+// =============================================================================
+
+// Bytes kept from the decoded SI and SO data
+#define LINK_CAPTURE_MAX_DECODED    16
+
+/**
+ * @brief Min/avg/max of one timing measurement, in nanoseconds
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t min_ns;
+    uint32_t max_ns;
+    uint32_t avg_ns;
+} link_capture_timing_t;
+
+/**
+ * @brief Timing decoded from one capture
+ */
+typedef struct {
+    uint32_t sample_hz;                 // Sample rate (resolution 1e9/sample_hz ns)
+    uint32_t samples;                   // Samples analyzed
+    
+    link_capture_timing_t bit_period;   // SC falling edge to next, within a byte
+    link_capture_timing_t clock_low;    // SC falling to rising edge
+    link_capture_timing_t si_setup;     // Last SI change to SC rising edge
+    link_capture_timing_t byte_gap;     // Last rising edge of a byte to the next falling edge
+    
+    uint32_t bytes;                     // Complete bytes (8 clocks) seen
+    uint8_t si_bytes[LINK_CAPTURE_MAX_DECODED];    // Data sent to the Game Boy
+    uint8_t so_bytes[LINK_CAPTURE_MAX_DECODED];    // Data from the Game Boy
+} link_capture_stats_t;
+
+// =============================================================================
+// Capture
+// =============================================================================
+
+/**
+ * @brief Arm a capture on a GB link port
+ * 
+ * Claims a free state machine (pio0, then pio1) and a DMA channel. The
+ * capture starts at the next falling edge of SC and fills
+ * LINK_CAPTURE_BUFFER_WORDS words at LINK_CAPTURE_SAMPLE_HZ.
+ * 
+ * @param port GB link port to watch (its SI, SC and SO pins must be
+ *             consecutive GPIOs, as in GB_LINK_PORT_PINS)
+ * @return true if armed, false if busy or out of PIO/DMA resources
+ */
+bool link_capture_start(uint8_t port);
+
+/**
+ * @brief Check if the capture buffer is full
+ * 
+ * @return true once all samples have been taken
+ */
+bool link_capture_is_done(void);
+
+/**
+ * @brief Abort a capture and free its resources
+ */
+void link_capture_stop(void);
+
+/**
+ * @brief Decode a finished (or stopped) capture
+ * 
+ * Frees the PIO and DMA resources. Only samples taken so far are
+ * decoded, so a capture stopped early still gives partial results.
+ * 
+ * @param stats Where to store the results
+ * @return true if any samples were analyzed
+ */
+bool link_capture_analyze(link_capture_stats_t *stats);
+
+/**
+ * @brief Print capture results with DEBUG_PRINT
+ * 
+ * @param stats Results from link_capture_analyze()
+ */
+void link_capture_print(const link_capture_stats_t *stats);
+
+/**
+ * @brief Run the standard link timing benchmark on a port
+ * 
+ * Captures a fixed three-byte message (a Note Off, harmless to mGB) and
+ * prints the results. Blocks until the bytes are on the wire.
+ * 
+ * @param port GB link port
+ * @param stats Where to store the results, or NULL to only print them
+ * @return true if the capture ran
+ */
+bool link_capture_benchmark(uint8_t port, link_capture_stats_t *stats);
+
+#endif // LINK_CAPTURE_H
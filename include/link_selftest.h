@@ -0,0 +1,80 @@
+/**
+ * @file link_selftest.h
+ * @brief GB link loopback throughput and bit error rate benchmark
+ * 
+ * With SI jumpered to SO, every byte the link clocks out comes straight
+ * back on SO. The self-test streams a repeatable pseudo-random sequence
+ * through the normal gb_link queue and PIO program at each clock rate and
+ * byte gap in LINK_SELFTEST_CLOCKS_HZ x LINK_SELFTEST_GAPS_US, compares
+ * the echo, and reports throughput, bit error rate and worst-case byte
+ * latency per setting. Use it to see how much headroom a cable and
+ * target rate have before relying on them.
+ * 
+ * Usage:
+ * 1. gb_link_init(), with no mode running (the sweep must be the only
+ *    writer to the port's TX queue)
+ * 2. Fit the SI-SO jumper on the port
+ * 3. link_selftest_run()
+ * 
+ * LINK_SELFTEST_AT_BOOT runs the sweep on port 0 at startup, before
+ * mGB mode starts.
+ */
+
+#ifndef LINK_SELFTEST_H
+#define LINK_SELFTEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Result of one clock rate / gap setting
+ */
+typedef struct {
+    uint32_t clock_hz;          // Clock rate the link actually ran at
+    uint32_t gap_us;            // Inter-byte gap
+    uint32_t bytes_sent;
+    uint32_t bytes_received;    // Echoes received before the timeout
+    uint32_t bit_errors;        // Wrong bits, plus 8 per lost byte
+    uint32_t elapsed_us;        // First byte queued to last echo
+    uint32_t throughput_bps;    // Payload bits per second
+    uint32_t max_latency_us;    // Worst byte, queued to echo received
+    uint32_t avg_latency_us;
+} link_selftest_result_t;
+
+/**
+ * @brief Stream test bytes at one setting and check the echo
+ * 
+ * The port's clock and gap are left at the tested setting.
+ * 
+ * @param port GB link port (master role, SI jumpered to SO)
+ * @param clock_hz Link clock rate to test
+ * @param gap_us Inter-byte gap to test
+ * @param bytes Number of bytes to send
+ * @param result Where to store the result
+ * @return false if the port is unusable (not active or not master)
+ */
+bool link_selftest_step(uint8_t port, uint32_t clock_hz, uint32_t gap_us,
+                        uint32_t bytes, link_selftest_result_t *result);
+
+/**
+ * @brief Run the full sweep of clock rates and gaps
+ * 
+ * Sends LINK_SELFTEST_BYTES at every setting, prints each result and
+ * restores the port's clock and gap afterwards.
+ * 
+ * @param port GB link port (master role, SI jumpered to SO)
+ * @param results Array for the results, or NULL to only print them
+ * @param max_results Size of the results array
+ * @return Number of settings tested
+ */
+uint32_t link_selftest_run(uint8_t port, link_selftest_result_t *results,
+                           uint32_t max_results);
+
+/**
+ * @brief Print one result with DEBUG_PRINT
+ * 
+ * @param result Result from link_selftest_step()
+ */
+void link_selftest_print(const link_selftest_result_t *result);
+
+#endif // LINK_SELFTEST_H
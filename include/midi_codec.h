@@ -0,0 +1,75 @@
+/**
+ * @file midi_codec.h
+ * @brief Table-driven MIDI status byte classification
+ *
+ * Shared by the DIN MIDI parser (midi_uart.c) and the USB-MIDI packet
+ * code (usb_midi.c). Every status byte maps to one entry of a 256-entry
+ * table built at compile time, so classification is a single indexed load
+ * instead of a switch ladder on every byte or packet.
+ *
+ * This module has no hardware dependencies and also builds on the host
+ * (see bench/midi_codec_bench.c).
+ */
+
+#ifndef MIDI_CODEC_H
+#define MIDI_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "midi_uart.h"
+
+// =============================================================================
+// Status Table
+// =============================================================================
+
+// data_length value for SysEx (variable length, terminated by 0xF7)
+#define MIDI_CODEC_LEN_SYSEX        0xFF
+
+// Flags
+#define MIDI_CODEC_FLAG_STATUS      0x01    // Bit 7 set (not a data byte)
+#define MIDI_CODEC_FLAG_CHANNEL     0x02    // Channel voice message (0x80-0xEF)
+#define MIDI_CODEC_FLAG_REALTIME    0x04    // System real-time (0xF8-0xFF)
+
+/**
+ * @brief Classification of a single status byte
+ */
+typedef struct {
+    uint8_t type;               // midi_message_type_t
+    uint8_t data_length;        // Data bytes that follow (MIDI_CODEC_LEN_SYSEX for 0xF0)
+    uint8_t flags;              // MIDI_CODEC_FLAG_*
+    uint8_t usb_cin;            // USB-MIDI code index number (0 if not sendable)
+} midi_status_info_t;
+
+/**
+ * @brief Status byte classification table, indexed by the raw byte
+ *
+ * Data bytes (0x00-0x7F) have type MIDI_MSG_NONE and no flags.
+ */
+extern const midi_status_info_t midi_status_table[256];
+
+/**
+ * @brief Total MIDI bytes carried by a USB-MIDI packet, indexed by CIN
+ */
+extern const uint8_t midi_usb_cin_length[16];
+
+// =============================================================================
+// Lookups
+// =============================================================================
+
+static inline midi_message_type_t midi_codec_get_type(uint8_t status) {
+    return (midi_message_type_t)midi_status_table[status].type;
+}
+
+static inline uint8_t midi_codec_get_data_length(uint8_t status) {
+    return midi_status_table[status].data_length;
+}
+
+static inline bool midi_codec_is_realtime(uint8_t status) {
+    return (midi_status_table[status].flags & MIDI_CODEC_FLAG_REALTIME) != 0;
+}
+
+static inline uint8_t midi_codec_get_usb_cin(uint8_t status) {
+    return midi_status_table[status].usb_cin;
+}
+
+#endif // MIDI_CODEC_H
@@ -1,15 +1,22 @@
 /**
  * @file midi_uart.h
- * @brief MIDI UART receiver with parsing
+ * @brief MIDI UART receiver with parsing, and MIDI OUT transmitter
  * 
  * This module handles receiving MIDI data from the DIN/TRS MIDI input
- * via UART. It provides a simple MIDI parser that handles:
+ * via UART, and sending to the DIN/TRS MIDI output on the same UART. It provides a simple MIDI parser that handles:
  * - Channel voice messages (Note On/Off, CC, Program Change, Pitch Bend, etc.)
  * - Running status
  * - Real-time messages (passed through)
  * - System common messages (basic support)
+ * - SysEx (streamed in small chunks, never buffered whole)
  * 
- * Uses interrupt-driven reception with a ring buffer.
+ * Uses interrupt-driven reception with a ring buffer, or DMA-driven
+ * reception into the same ring when MIDI_RX_BACKEND is MIDI_RX_BACKEND_DMA.
+ * 
+ * Additional DIN inputs (MIDI_PIO_RX_PORT_COUNT) are received by PIO UART
+ * state machines. Every input port has its own ring, parser and counters;
+ * midi_uart_process() merges the ports byte by byte in arrival order, so
+ * all inputs come out as one time-ordered message stream.
  */
 
 #ifndef MIDI_UART_H
@@ -61,8 +68,27 @@ typedef struct {
     uint8_t data2;              // Second data byte (velocity, CC value, etc.)
     uint8_t raw[3];             // Raw bytes for pass-through
     uint8_t length;             // Number of valid bytes in raw[]
+    uint8_t port;               // DIN input port (0 = UART MIDI IN, always 0 for USB)
+    uint32_t timestamp_us;      // Arrival time of the first byte (timer_hw->timerawl)
 } midi_message_t;
 
+/**
+ * @brief Per-port receive statistics
+ */
+typedef struct {
+    uint32_t rx_count;              // Bytes received
+    uint32_t message_count;         // Complete messages parsed
+    uint32_t error_count;           // Bytes lost to software RX ring overruns
+    uint32_t irq_count;             // RX interrupts that took bytes from this port
+                                    // (0 for the UART port with DMA)
+    uint16_t rx_high_water;         // Deepest RX ring fill level seen
+    uint32_t framing_error_count;   // Framing errors (PIO ports also count breaks here)
+    uint32_t parity_error_count;    // Parity errors (UART port only)
+    uint32_t break_count;           // Break conditions (UART port only)
+    uint32_t overrun_error_count;   // Hardware FIFO overruns (UART port only)
+    uint32_t sysex_drop_count;      // SysEx dumps dropped while another port was streaming one
+} midi_uart_port_stats_t;
+
 // =============================================================================
 // Callback Types
 // =============================================================================
@@ -70,7 +96,8 @@ typedef struct {
 /**
  * @brief Callback for complete MIDI messages
  * 
- * Called from interrupt context - keep processing minimal!
+ * Called from midi_uart_process(), or from the RX interrupt when
+ * MIDI_RX_PARSE_IN_ISR is set - keep processing minimal!
  * 
  * @param msg Parsed MIDI message
  */
@@ -79,12 +106,55 @@ typedef void (*midi_message_callback_t)(const midi_message_t *msg);
 /**
  * @brief Callback for raw MIDI bytes (for pass-through modes)
  * 
- * Called from interrupt context for every received byte.
+ * Called from interrupt context for every byte received on port 0 (the
+ * UART input); bytes from other ports would interleave mid-message. With
+ * the DMA receive backend it is called from midi_uart_process() instead.
  * 
  * @param byte Raw MIDI byte
  */
 typedef void (*midi_byte_callback_t)(uint8_t byte);
 
+/**
+ * @brief Callback for streamed SysEx data
+ * 
+ * Called as SysEx bytes arrive, in chunks of up to 3 bytes, so a dump of
+ * any size passes through without being buffered. The first chunk starts
+ * with 0xF0. The final chunk has end set and finishes with 0xF7 (one is
+ * supplied if the dump was cut short by another status byte). Only full
+ * 3-byte chunks are delivered with end clear.
+ * 
+ * Real-time bytes inside a dump are delivered through the message
+ * callback as usual and do not disturb the SysEx stream.
+ * 
+ * Only one input port streams SysEx at a time. A dump that starts on
+ * another port while one is in progress is dropped whole (see
+ * midi_uart_port_stats_t.sysex_drop_count).
+ * 
+ * @param bytes SysEx bytes
+ * @param length Number of bytes (1-3)
+ * @param end true if this chunk terminates the message
+ */
+typedef void (*midi_sysex_callback_t)(const uint8_t *bytes, uint8_t length, bool end);
+
+/**
+ * @brief Callback for real-time bytes (clock, start, stop, continue, ...)
+ * 
+ * Called from the UART interrupt as soon as a 0xF8-0xFF byte arrives,
+ * without waiting for midi_uart_process(), so its latency does not depend
+ * on how busy the main loop is. Keep it short. With the DMA receive
+ * backend it is called from midi_uart_process() instead.
+ * 
+ * Real-time messages are still delivered through the message callback
+ * from midi_uart_process() afterwards (straight away from the interrupt
+ * with MIDI_RX_PARSE_IN_ISR). Without this callback the fast lane only
+ * moves real-time bytes ahead of other pending input in
+ * midi_uart_process(); their latency still depends on the main loop.
+ * 
+ * @param byte Real-time status byte
+ * @param timestamp_us Arrival time (timer_hw->timerawl)
+ */
+typedef void (*midi_realtime_callback_t)(uint8_t byte, uint32_t timestamp_us);
+
 // =============================================================================
 // Initialization
 // =============================================================================
@@ -92,7 +162,8 @@ typedef void (*midi_byte_callback_t)(uint8_t byte);
 /**
  * @brief Initialize MIDI UART receiver
  * 
- * Sets up UART1 at 31250 baud with interrupt-driven reception.
+ * Sets up UART1 at 31250 baud with interrupt- or DMA-driven reception
+ * depending on MIDI_RX_BACKEND.
  * 
  * @return true if initialization successful
  */
@@ -123,6 +194,20 @@ void midi_uart_set_message_callback(midi_message_callback_t callback);
  */
 void midi_uart_set_byte_callback(midi_byte_callback_t callback);
 
+/**
+ * @brief Set callback for streamed SysEx data
+ * 
+ * @param callback Function to call for each SysEx chunk
+ */
+void midi_uart_set_sysex_callback(midi_sysex_callback_t callback);
+
+/**
+ * @brief Set callback for real-time bytes
+ * 
+ * @param callback Function to call from the UART ISR for each real-time byte
+ */
+void midi_uart_set_realtime_callback(midi_realtime_callback_t callback);
+
 // =============================================================================
 // Polling Interface (alternative to callbacks)
 // =============================================================================
@@ -137,6 +222,12 @@ bool midi_uart_message_available(void);
 /**
  * @brief Get the next complete MIDI message
  * 
+ * Messages are delivered in arrival order from a queue of
+ * MIDI_MSG_QUEUE_SIZE entries, so several messages parsed in one
+ * midi_uart_process() call are all retained. Messages from all input
+ * ports share the queue and are ordered by the arrival time of their
+ * last byte; msg->port tells them apart.
+ * 
  * @param msg Pointer to message structure to fill
  * @return true if a message was available
  */
@@ -147,15 +238,86 @@ bool midi_uart_get_message(midi_message_t *msg);
  * 
  * Call this regularly from the main loop if using polling mode.
  * Processes any bytes in the receive buffer and calls registered callbacks.
+ * With MIDI_RX_PARSE_IN_ISR the interrupts have done this already, and
+ * only the polling interface needs the main loop.
  */
 void midi_uart_process(void);
 
+// =============================================================================
+// MIDI Output
+// =============================================================================
+
+/**
+ * @brief Queue a MIDI message for MIDI OUT
+ * 
+ * Never blocks: the bytes go into a TX ring drained by the UART TX
+ * interrupt. The message is queued whole or not at all.
+ * 
+ * @param msg Message to send (raw[] and length are used)
+ * @return true if queued, false if the TX ring is full
+ */
+bool midi_uart_send_message(const midi_message_t *msg);
+
+/**
+ * @brief Queue raw MIDI bytes for MIDI OUT
+ * 
+ * Suitable for SysEx chunks and anything else not held in a
+ * midi_message_t. Running status is applied if bytes[0] is a channel
+ * status byte.
+ * 
+ * @param bytes Bytes to send
+ * @param length Number of bytes
+ * @return true if queued, false if the TX ring is full
+ */
+bool midi_uart_send_raw(const uint8_t *bytes, uint8_t length);
+
+/**
+ * @brief Enable or disable running status on MIDI OUT
+ * 
+ * When enabled, a channel status byte equal to the previous one is
+ * omitted, saving up to a third of the wire bytes for dense streams.
+ * 
+ * @param enabled true to omit repeated status bytes
+ */
+void midi_uart_set_tx_running_status(bool enabled);
+
+/**
+ * @brief Get free space in the MIDI OUT ring
+ * 
+ * @return Number of bytes that can be queued
+ */
+uint16_t midi_uart_tx_free(void);
+
 // =============================================================================
 // Statistics
 // =============================================================================
 
+/**
+ * @brief Get the number of DIN MIDI input ports
+ * 
+ * Port 0 is the hardware UART; ports 1 and up are PIO receivers. Ports
+ * whose state machine could not be claimed at init are not counted.
+ */
+uint8_t midi_uart_get_port_count(void);
+
+/**
+ * @brief Get the receive statistics of one input port
+ * 
+ * The totals returned by the getters below are summed over all ports.
+ * 
+ * @param port Input port index
+ * @param stats Structure to fill
+ * @return true if the port exists
+ */
+bool midi_uart_get_port_stats(uint8_t port, midi_uart_port_stats_t *stats);
+
 /**
  * @brief Get count of received MIDI bytes
+ * 
+ * Every received byte is stamped with the 1 MHz system timer as it is
+ * taken from the UART, and parsed messages carry the stamp of their first
+ * byte in midi_message_t.timestamp_us. With the DMA receive backend the
+ * stamp is the time midi_uart_process() first saw the byte.
  */
 uint32_t midi_uart_get_rx_count(void);
 
@@ -165,10 +327,110 @@ uint32_t midi_uart_get_rx_count(void);
 uint32_t midi_uart_get_message_count(void);
 
 /**
- * @brief Get count of buffer overrun errors
+ * @brief Get count of software RX ring overruns
+ * 
+ * Counts bytes lost because the main loop did not drain the ring in
+ * time (CPU overload). Hardware line errors are counted separately below.
  */
 uint32_t midi_uart_get_error_count(void);
 
+/**
+ * @brief Get the deepest parsed message queue fill level seen
+ */
+uint16_t midi_uart_get_queue_high_water(void);
+
+/**
+ * @brief Get count of parsed messages dropped because the queue was full
+ */
+uint32_t midi_uart_get_queue_drop_count(void);
+
+/**
+ * @brief Get count of real-time bytes dropped from the ISR fast lane
+ * 
+ * The real-time callback still saw them; only the copy queued for the
+ * message callback in midi_uart_process() was lost.
+ */
+uint32_t midi_uart_get_rt_drop_count(void);
+
+/**
+ * @brief Get count of UART RX interrupts taken
+ * 
+ * Always 0 with the DMA receive backend. Compare with
+ * midi_uart_get_rx_count() to see the bytes handled per interrupt. The
+ * PIO input ports are counted per port in midi_uart_port_stats_t.
+ */
+uint32_t midi_uart_get_rx_irq_count(void);
+
+/**
+ * @brief Get the deepest RX ring fill level seen by midi_uart_process()
+ * 
+ * Maximum over all input ports.
+ */
+uint16_t midi_uart_get_rx_high_water(void);
+
+/**
+ * @brief Get count of bytes received with a framing error
+ * 
+ * Framing errors and breaks usually point at wiring or a bad cable.
+ * Bytes with any line error are discarded and reset the parser's
+ * running status.
+ */
+uint32_t midi_uart_get_framing_error_count(void);
+
+/**
+ * @brief Get count of bytes received with a parity error
+ */
+uint32_t midi_uart_get_parity_error_count(void);
+
+/**
+ * @brief Get count of break conditions (RX held low for a whole frame)
+ */
+uint32_t midi_uart_get_break_count(void);
+
+/**
+ * @brief Get count of UART hardware FIFO overruns
+ * 
+ * The 32-byte UART FIFO filled before it was read, i.e. the RX interrupt
+ * (or DMA) was held off for too long.
+ */
+uint32_t midi_uart_get_overrun_error_count(void);
+
+/**
+ * @brief Get the parse latency of the most recent message
+ * 
+ * Time from the arrival of a message's last byte to the message being
+ * queued and passed to the message callback. With MIDI_RX_PARSE_IN_ISR
+ * this is only the parser's own run time; otherwise it also includes the
+ * wait for the next midi_uart_process() call. Build both ways and compare
+ * midi_uart_get_parse_latency_max_us() under the same load to measure
+ * what parsing in the interrupt saves.
+ * 
+ * @return Latency in microseconds
+ */
+uint32_t midi_uart_get_parse_latency_last_us(void);
+
+/**
+ * @brief Get the worst parse latency seen since the last stats reset
+ * 
+ * @return Latency in microseconds
+ */
+uint32_t midi_uart_get_parse_latency_max_us(void);
+
+/**
+ * @brief Get count of bytes written to MIDI OUT
+ */
+uint32_t midi_uart_get_tx_count(void);
+
+/**
+ * @brief Get count of messages rejected because the TX ring was full
+ */
+uint32_t midi_uart_get_tx_drop_count(void);
+
+/**
+ * @brief Get count of status bytes saved by running status
+ */
+uint32_t midi_uart_get_tx_saved_count(void);
+
 /**
  * @brief Reset all statistics
  */
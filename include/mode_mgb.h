@@ -21,6 +21,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "config.h"
+#include "gb_link.h"
+
 // =============================================================================
 // mGB Channel Mapping
 // =============================================================================
@@ -40,20 +43,103 @@
 #define MGB_CHANNEL_POLY    4
 #define MGB_CHANNEL_COUNT   5
 
+// =============================================================================
+// Device SysEx
+// =============================================================================
+
+/**
+ * SysEx understood on USB (manufacturer ID 0x7D, non-commercial):
+ * - F0 7D 01 pp F7: request the GB link trace of port pp
+ * - F0 7D 02 pp nn nn <entries> F7: the reply, nn nn = entry count (LSB
+ *   first, 7 bits each), then per entry, oldest first: the data byte as
+ *   2 groups of 7 bits, the queue time and the wire time (µs) as 5 groups
+ *   of 7 bits each, least significant group first. A wire time of 0 means
+ *   the byte was not clocked out.
+ */
+#define MGB_SYSEX_ID                0x7D
+#define MGB_SYSEX_TRACE_REQUEST     0x01
+#define MGB_SYSEX_TRACE_DUMP        0x02
+
 // =============================================================================
 // Configuration
 // =============================================================================
 
+/**
+ * @brief How MIDI is distributed over several Game Boys
+ */
+typedef enum {
+    MGB_ROUTING_BROADCAST = 0,  // Every port plays port 0's mapping
+    MGB_ROUTING_PER_PORT,       // Each port follows its own mapping
+} mgb_routing_t;
+
+/**
+ * @brief Where a message for the Game Boys came from
+ */
+typedef enum {
+    MGB_SOURCE_DIN = 0,         // DIN MIDI inputs (all ports)
+    MGB_SOURCE_USB,             // USB-MIDI from the host
+    MGB_SOURCE_COUNT
+} mgb_source_t;
+
+/**
+ * @brief Priority classes of the output stage, highest first
+ */
+typedef enum {
+    MGB_CLASS_NOTE = 0,         // Note on/off
+    MGB_CLASS_PROGRAM,          // Program change
+    MGB_CLASS_CONTROLLER,       // Control change, pitch bend, pressure
+    MGB_CLASS_COUNT
+} mgb_class_t;
+
+/**
+ * @brief Output queueing delay of one class, queued to handed to the link
+ */
+typedef struct {
+    uint32_t count;             // Messages measured
+    uint32_t last_us;
+    uint32_t max_us;
+    uint32_t avg_us;
+} mgb_queue_delay_t;
+
 /**
  * @brief mGB mode configuration
  */
 typedef struct {
-    // MIDI channel mapping: midi_channel[n] = mGB channel for MIDI ch n+1
-    // Default: MIDI 1→PU1, MIDI 2→PU2, MIDI 3→WAV, MIDI 4→NOI, MIDI 5→POLY
-    uint8_t midi_to_mgb_channel[16];
+    // Routing over the GB link ports
+    // Default: MGB_ROUTING_BROADCAST
+    mgb_routing_t routing;
+    
+    // MIDI channel mapping per link port:
+    // midi_to_mgb_channel[port][n] = mGB channel for MIDI ch n+1, 0xFF = none
+    // Default on every port: MIDI 1→PU1, MIDI 2→PU2, MIDI 3→WAV, MIDI 4→NOI, MIDI 5→POLY
+    uint8_t midi_to_mgb_channel[GB_LINK_PORT_COUNT][16];
     
     // Enable/disable channels
     bool channel_enabled[MGB_CHANNEL_COUNT];
+    
+    // Gap between bytes sent to mGB in µs, enforced by the GB link PIO
+    // Default: MGB_INTER_BYTE_DELAY_US
+    uint16_t byte_gap_us;
+    
+    // GB link clock profile (GB_LINK_PROFILE_CALIBRATED after calibration)
+    // Default: GB_LINK_PROFILE_DMG_MGB
+    gb_link_profile_t link_profile;
+    
+    // Omit repeated status bytes on each link port (running status). Only
+    // enable for targets whose ROM parses running status.
+    // Default: MGB_RUNNING_STATUS on every port
+    bool running_status[GB_LINK_PORT_COUNT];
+    
+    // Send the status byte again after this many messages without it, so a
+    // target that lost a byte resyncs (0 = only after a quiet link)
+    // Default: MGB_RUNNING_STATUS_REFRESH
+    uint8_t running_status_refresh;
+    
+    // Send MIDI real-time bytes (clock, start, stop, continue) to each link
+    // port straight from the RX interrupt, ahead of every queued message.
+    // mGB itself ignores them; enable for targets that sync to MIDI clock.
+    // Default: MGB_FORWARD_REALTIME on every port
+    bool forward_realtime[GB_LINK_PORT_COUNT];
 } mode_mgb_config_t;
 
 // =============================================================================
@@ -128,9 +214,100 @@ uint32_t mode_mgb_get_forward_count(void);
  */
 uint32_t mode_mgb_get_drop_count(void);
 
+/**
+ * @brief Get count of messages from one source forwarded to mGB
+ * 
+ * @param source Input source
+ */
+uint32_t mode_mgb_get_source_forward_count(mgb_source_t source);
+
+/**
+ * @brief Get count of messages from one source dropped
+ * 
+ * Messages are dropped when the source's queue (MGB_SOURCE_QUEUE_SIZE)
+ * is full because the link cannot keep up. DIN messages lost before
+ * that, in the parser's queue, are counted by
+ * midi_uart_get_queue_drop_count().
+ * 
+ * @param source Input source
+ */
+uint32_t mode_mgb_get_source_drop_count(mgb_source_t source);
+
+/**
+ * @brief Get count of controller updates merged into queued ones
+ * 
+ * Counts control change, pitch bend and pressure messages that replaced
+ * an unsent message for the same controller in the output queue instead
+ * of taking a slot of their own.
+ */
+uint32_t mode_mgb_get_coalesced_count(void);
+
+/**
+ * @brief Get count of controller updates that found a stale backlog
+ * 
+ * Debug builds check every queued controller update: its (channel,
+ * controller) may have no other update waiting, and the link may hold no
+ * more than the message on the wire. Stays 0 however fast a sweep comes
+ * in; always 0 with NDEBUG.
+ */
+uint32_t mode_mgb_get_stale_update_count(void);
+
+/**
+ * @brief Get count of status bytes left out by running status
+ * 
+ * @return Link bytes saved on all ports
+ */
+uint32_t mode_mgb_get_running_status_saved_count(void);
+
+/**
+ * @brief Get the output queueing delay of a priority class
+ * 
+ * Measured per port from the moment a message enters its class queue to
+ * the moment it is handed to the GB link TX ring.
+ * 
+ * @param cls Priority class
+ * @param delay Where to store the statistics
+ */
+void mode_mgb_get_queue_delay(mgb_class_t cls, mgb_queue_delay_t *delay);
+
+/**
+ * @brief Get latency of the most recently forwarded message
+ * 
+ * Measured from the arrival of the message's first MIDI byte to the
+ * moment the release alarm handed it to the GB link TX ring, so the time
+ * spent in the merge and output queues is included.
+ * 
+ * @return Latency in microseconds
+ */
+uint32_t mode_mgb_get_latency_last_us(void);
+
+/**
+ * @brief Get worst-case input-to-link latency since the last reset
+ * 
+ * @return Latency in microseconds
+ */
+uint32_t mode_mgb_get_latency_max_us(void);
+
 /**
  * @brief Reset statistics
  */
 void mode_mgb_reset_stats(void);
 
+// =============================================================================
+// Diagnostics
+// =============================================================================
+
+/**
+ * @brief Send a GB link port's transmit trace to the USB host as SysEx
+ * 
+ * Sent in reply to the trace request SysEx, or on demand. Takes a copy
+ * of the trace and returns at once; mode_mgb_process() then streams the
+ * dump as the USB FIFO frees up. DIN to USB thru waits until it is out.
+ * Empty unless built with GB_LINK_TRACE.
+ * 
+ * @param port GB link port
+ * @return false if a dump is still being sent
+ */
+bool mode_mgb_dump_link_trace(uint8_t port);
+
 #endif // MODE_MGB_H
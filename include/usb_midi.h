@@ -44,7 +44,8 @@ bool usb_midi_is_mounted(void);
  * @brief Process received USB-MIDI data
  * 
  * Call this regularly to handle incoming USB-MIDI messages.
- * Calls the registered callback for each received message.
+ * Calls the registered callback for each received message, stamped with
+ * the 1 MHz system timer at the moment its packet was read.
  */
 void usb_midi_process_rx(void);
 
@@ -76,6 +77,44 @@ bool usb_midi_send_message(const midi_message_t *msg);
  */
 bool usb_midi_send_raw(const uint8_t *bytes, uint8_t length);
 
+/**
+ * @brief Send a chunk of a SysEx message to USB host
+ * 
+ * Emits one USB-MIDI packet: CIN 0x4 for a start/continue chunk, or
+ * CIN 0x5/0x6/0x7 for a final chunk of 1/2/3 bytes. Matches the chunks
+ * produced by midi_sysex_callback_t.
+ * 
+ * @param bytes SysEx bytes
+ * @param length Number of bytes (must be 3 unless end is set)
+ * @param end true if this chunk terminates the message
+ * @return true if the packet was sent
+ */
+bool usb_midi_send_sysex(const uint8_t *bytes, uint8_t length, bool end);
+
+/**
+ * @brief Send a MIDI message to USB host if the FIFO has room
+ * 
+ * For senders that keep the message and retry on a later pass: a full
+ * FIFO is not counted as a drop.
+ * 
+ * @param msg MIDI message to send
+ * @return true if message was sent
+ */
+bool usb_midi_try_send_message(const midi_message_t *msg);
+
+/**
+ * @brief Send a chunk of a SysEx message if the USB FIFO has room
+ * 
+ * For long dumps generated by the device, which are streamed a few
+ * packets per main loop pass. A full FIFO is not counted as a drop.
+ * 
+ * @param bytes SysEx bytes
+ * @param length Number of bytes (must be 3 unless end is set)
+ * @param end true if this chunk terminates the message
+ * @return true if the packet was sent
+ */
+bool usb_midi_try_send_sysex(const uint8_t *bytes, uint8_t length, bool end);
+
 // =============================================================================
 // Statistics
 // =============================================================================
@@ -90,6 +129,11 @@ uint32_t usb_midi_get_rx_count(void);
  */
 uint32_t usb_midi_get_tx_count(void);
 
+/**
+ * @brief Get count of packets dropped because the USB TX FIFO was full
+ */
+uint32_t usb_midi_get_tx_drop_count(void);
+
 /**
  * @brief Reset statistics
  */
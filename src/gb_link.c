@@ -2,37 +2,812 @@
  * @file gb_link.c
  * @brief Game Boy Link Cable interface driver implementation
  * 
- * Uses PIO for precise timing of the Game Boy serial protocol.
- * Currently implements TX-only for mGB mode.
+ * Uses PIO for precise timing of the Game Boy serial protocol. The PIO
+ * program is full duplex: every byte clocked out on SI also clocks a byte
+ * in on SO, which lands in the RX FIFO.
+ * 
+ * Up to GB_LINK_PORT_COUNT Game Boys are driven, one state machine per
+ * port. Each PIO block in use loads the programs once and shares them
+ * between its state machines; ports take pio0 first, then pio1. Every
+ * port has its own queues, clock, pacing, role and statistics.
+ * 
+ * Bytes to send are queued in a RAM ring of GB_TX_QUEUE_SIZE bytes that a
+ * DMA channel, paced by the state machine's TX DREQ, feeds into the PIO
+ * TX FIFO. Senders return immediately and the link streams in the
+ * background with no CPU time per byte.
+ * 
+ * When the last queued byte and its gap are done, the PIO program raises
+ * an IRQ flag; the interrupt handler marks the port idle and runs the
+ * idle callback, so nothing has to poll or guess how long a byte takes.
+ * 
+ * With GB_LINK_RX_DMA a DMA channel in ring mode moves received bytes
+ * from the RX FIFO into a RAM ring, so nothing is lost if the caller
+ * reads them late. Otherwise the 4-entry RX FIFO is read directly.
+ * 
+ * With GB_LINK_TRACE every byte queued is also recorded with its queue
+ * time, and the PIO program flags the end of every byte instead of only
+ * idle, so the interrupt handler can stamp when each byte was on the wire.
+ * 
+ * In slave role the Game Boy drives SC and a second program follows its
+ * clock. Both programs stay loaded so switching roles only restarts the
+ * state machine. Bytes received as slave are read by an interrupt and
+ * stamped with their completion time.
  */
 
 #include "gb_link.h"
 #include "config.h"
-#include "gb_link_tx.pio.h"
+#include "gb_link.pio.h"
 
 #include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "hardware/clocks.h"
 #include "pico/stdlib.h"
 
 #include <string.h>
 
+_Static_assert((GB_RX_BUFFER_SIZE & (GB_RX_BUFFER_SIZE - 1)) == 0,
+               "GB_RX_BUFFER_SIZE must be a power of 2");
+_Static_assert((GB_TX_QUEUE_SIZE & (GB_TX_QUEUE_SIZE - 1)) == 0,
+               "GB_TX_QUEUE_SIZE must be a power of 2");
+_Static_assert((GB_LINK_TRACE_SIZE & (GB_LINK_TRACE_SIZE - 1)) == 0,
+               "GB_LINK_TRACE_SIZE must be a power of 2");
+_Static_assert(GB_LINK_PORT_COUNT >= 1 && GB_LINK_PORT_COUNT <= 4,
+               "GB_LINK_PORT_COUNT must be 1 to 4");
+
+// =============================================================================
+// Private Types
+// =============================================================================
+
+/**
+ * @brief State of one link port
+ */
+typedef struct {
+    uint8_t index;
+    bool active;                        // State machine and DMA running
+    
+    // PIO resources
+    PIO pio;
+    uint sm;
+    uint pin_si;
+    uint pin_sc;
+    uint pin_so;
+    
+    // Settings, kept across gb_link_deinit()
+    gb_link_role_t role;
+    gb_link_profile_t profile;
+    uint32_t clock_hz;
+    uint32_t byte_gap_us;
+    gb_link_idle_callback_t idle_callback;
+    
+    // Transmit ring producer index and the DMA channel consuming it
+    volatile uint16_t tx_head;
+    int tx_dma_chan;
+    
+    // Set when bytes are queued, cleared by the PIO idle interrupt
+    volatile bool tx_busy;
+
+#if GB_LINK_RX_DMA
+    // Receive ring indices and the DMA channel filling it
+    uint16_t rx_head;
+    uint16_t rx_tail;
+    int rx_dma_chan;
+    
+    // Transfer count last seen, used to count bytes and detect overruns
+    uint32_t rx_dma_remaining;
+#endif
+
+    // Slave role receive ring indices
+    volatile uint16_t slave_rx_head;
+    volatile uint16_t slave_rx_tail;
+
+#if GB_LINK_TRACE
+    // Bytes recorded, bytes stamped with their wire time, first byte to report
+    volatile uint32_t trace_head;
+    uint32_t trace_done;
+    uint32_t trace_start;
+#endif
+    
+    // Statistics
+    volatile uint32_t tx_count;
+    volatile uint32_t rx_count;
+    volatile uint32_t rx_overrun_count;
+} gb_link_port_state_t;
+
+/**
+ * @brief Programs loaded into one PIO block, shared by its ports
+ */
+typedef struct {
+    uint8_t users;                      // Ports running on this block
+    uint txrx_offset;
+    uint slave_offset;
+} gb_link_pio_programs_t;
+
 // =============================================================================
 // Private State
 // =============================================================================
 
-// PIO configuration
-static PIO      s_pio = pio0;
-static uint     s_sm = 0;
-static uint     s_pio_offset = 0;
-static bool     s_initialized = false;
+#define PORT_DEFAULTS {                                 \
+    .role = GB_LINK_ROLE_MASTER,                        \
+    .profile = GB_LINK_PROFILE_DMG_MGB,                 \
+    .clock_hz = GB_LINK_DEFAULT_CLOCK_HZ,               \
+    .byte_gap_us = GB_LINK_DEFAULT_GAP_US,              \
+}
 
-// Statistics
-static volatile uint32_t s_tx_count = 0;
+static gb_link_port_state_t s_ports[GB_LINK_PORT_COUNT] = {
+    [0 ... GB_LINK_PORT_COUNT - 1] = PORT_DEFAULTS
+};
+static uint8_t s_port_count = 0;
+static bool s_initialized = false;
+
+// Pins of each port: { SI, SC, SO }
+static const uint8_t s_port_pins[][3] = GB_LINK_PORT_PINS;
+_Static_assert(sizeof(s_port_pins) / sizeof(s_port_pins[0]) >= GB_LINK_PORT_COUNT,
+               "GB_LINK_PORT_PINS needs an entry per port");
+
+// Programs per PIO block, indexed by pio_get_index()
+static gb_link_pio_programs_t s_programs[2];
+
+// Transmit rings read by DMA, each aligned to its size for address wrapping
+// (producer: senders, consumer: the port's TX DMA channel)
+static volatile uint8_t s_tx_ring[GB_LINK_PORT_COUNT][GB_TX_QUEUE_SIZE]
+    __attribute__((aligned(GB_TX_QUEUE_SIZE)));
+
+#if GB_LINK_RX_DMA
+// Receive rings written by DMA, each aligned to its size for address wrapping
+static volatile uint8_t s_rx_buffer[GB_LINK_PORT_COUNT][GB_RX_BUFFER_SIZE]
+    __attribute__((aligned(GB_RX_BUFFER_SIZE)));
+
+// Transfer count loaded on every (re)arm
+#define RX_DMA_TRANSFER_COUNT   0xFFFFFFFFu
+
+// Re-arm once half the transfer count is used
+#define RX_DMA_REARM_THRESHOLD  0x80000000u
+#endif
+
+// Slave role receive rings, filled by on_link_pio_irq() with completion times
+static volatile uint8_t  s_slave_rx_data[GB_LINK_PORT_COUNT][GB_RX_BUFFER_SIZE];
+static volatile uint32_t s_slave_rx_time[GB_LINK_PORT_COUNT][GB_RX_BUFFER_SIZE];
+
+#if GB_LINK_TRACE
+// Transmit trace rings, indexed by byte number (trace_head)
+static gb_link_trace_entry_t s_trace[GB_LINK_PORT_COUNT][GB_LINK_TRACE_SIZE];
+#endif
+
+// PIO interrupt line used for the idle flag and slave reception
+// (the MIDI PIO inputs use 0)
+#define GB_LINK_PIO_IRQ_INDEX   1
+
+// PIO cycles per link bit (see gb_link.pio)
+#define GB_LINK_CYCLES_PER_BIT  16u
+
+// Clock profiles; the calibrated entry is overwritten by gb_link_calibrate()
+static gb_link_clock_profile_t s_profiles[GB_LINK_PROFILE_COUNT] = {
+    [GB_LINK_PROFILE_DMG_MGB]          = { "DMG mGB",          GB_LINK_DEFAULT_CLOCK_HZ },
+    [GB_LINK_PROFILE_CGB_DOUBLE_SPEED] = { "CGB double speed", 16384 },
+    [GB_LINK_PROFILE_CALIBRATED]       = { "Calibrated",       GB_LINK_DEFAULT_CLOCK_HZ },
+};
+
+// Calibration test pattern: alternating, solid and nibble-split bits
+static const uint8_t s_cal_pattern[] = {
+    0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x33, 0xCC, 0x01, 0x80
+};
+
+// =============================================================================
+// Helper Functions
+// =============================================================================
+
+/**
+ * @brief Look up a port's state
+ * 
+ * @return Port state, or NULL if the port does not exist
+ */
+static gb_link_port_state_t *get_port(uint8_t port) {
+    if (port >= GB_LINK_PORT_COUNT) {
+        return NULL;
+    }
+    return &s_ports[port];
+}
+
+/**
+ * @brief Look up a port that is running
+ * 
+ * @return Port state, or NULL if the port does not exist or is not running
+ */
+static gb_link_port_state_t *get_active_port(uint8_t port) {
+    gb_link_port_state_t *p = get_port(port);
+    return (p != NULL && p->active) ? p : NULL;
+}
+
+/**
+ * @brief Convert a gap in microseconds to PIO cycles at the port's clock
+ */
+static uint32_t gap_us_to_cycles(const gb_link_port_state_t *p, uint32_t gap_us) {
+    return (uint32_t)(((uint64_t)gap_us * p->clock_hz * GB_LINK_CYCLES_PER_BIT
+                       + 500000u) / 1000000u);
+}
+
+// =============================================================================
+// Receive DMA
+// =============================================================================
 
-// Game Boy link clock frequency (Hz)
-// The GB runs at ~8192 Hz internally, but mGB is flexible
-// Arduinoboy uses slightly slower timing with delays
-#define GB_LINK_CLOCK_HZ    8000
+#if GB_LINK_RX_DMA
+
+/**
+ * @brief Claim and start a port's RX DMA channel
+ * 
+ * Byte-wide reads of the RX FIFO register return the low byte, which is
+ * where the PIO program leaves the received byte.
+ */
+static bool rx_dma_start(gb_link_port_state_t *p) {
+    p->rx_dma_chan = dma_claim_unused_channel(false);
+    if (p->rx_dma_chan < 0) {
+        DEBUG_PRINT("GB Link: Failed to claim RX DMA channel\n");
+        return false;
+    }
+    
+    dma_channel_config c = dma_channel_get_default_config(p->rx_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, __builtin_ctz(sizeof(s_rx_buffer[0])));
+    channel_config_set_dreq(&c, pio_get_dreq(p->pio, p->sm, false));
+    
+    dma_channel_configure(
+        p->rx_dma_chan,
+        &c,
+        s_rx_buffer[p->index],          // Write into the port's ring
+        &p->pio->rxf[p->sm],            // Read from the SM's RX FIFO
+        RX_DMA_TRANSFER_COUNT,
+        true                            // Start immediately
+    );
+    p->rx_dma_remaining = RX_DMA_TRANSFER_COUNT;
+    p->rx_head = 0;
+    p->rx_tail = 0;
+    
+    return true;
+}
+
+/**
+ * @brief Stop a port's RX DMA channel while the slave role reads the FIFO
+ */
+static void rx_dma_pause(gb_link_port_state_t *p) {
+    dma_channel_abort(p->rx_dma_chan);
+}
+
+/**
+ * @brief Restart a port's RX DMA channel from an empty ring
+ */
+static void rx_dma_resume(gb_link_port_state_t *p) {
+    dma_channel_set_write_addr(p->rx_dma_chan, s_rx_buffer[p->index], false);
+    dma_channel_set_trans_count(p->rx_dma_chan, RX_DMA_TRANSFER_COUNT, true);
+    p->rx_dma_remaining = RX_DMA_TRANSFER_COUNT;
+    p->rx_head = 0;
+    p->rx_tail = 0;
+}
+
+/**
+ * @brief Stop and release a port's RX DMA channel
+ */
+static void rx_dma_stop(gb_link_port_state_t *p) {
+    if (p->rx_dma_chan < 0) {
+        return;
+    }
+    
+    dma_channel_abort(p->rx_dma_chan);
+    dma_channel_unclaim(p->rx_dma_chan);
+    p->rx_dma_chan = -1;
+}
+
+/**
+ * @brief Update a port's ring head from the DMA write address
+ * 
+ * Also reloads the transfer count before it runs out. An overrun (more
+ * bytes received than there was free space) discards the unread bytes.
+ */
+static void rx_dma_update_head(gb_link_port_state_t *p) {
+    dma_channel_hw_t *hw = dma_channel_hw_addr(p->rx_dma_chan);
+    
+    if (hw->transfer_count < RX_DMA_REARM_THRESHOLD) {
+        dma_channel_abort(p->rx_dma_chan);
+    }
+    
+    // Read the count first: the head can only be ahead of it, never behind
+    uint32_t remaining = hw->transfer_count;
+    uint16_t head = (uint16_t)(hw->write_addr - (uintptr_t)s_rx_buffer[p->index])
+                    & (GB_RX_BUFFER_SIZE - 1);
+    
+    uint32_t received = p->rx_dma_remaining - remaining;
+    p->rx_dma_remaining = remaining;
+    p->rx_count += received;
+    
+    uint16_t unread = (p->rx_head - p->rx_tail) & (GB_RX_BUFFER_SIZE - 1);
+    if (received >= (uint32_t)(GB_RX_BUFFER_SIZE - unread)) {
+        p->rx_overrun_count++;
+        p->rx_tail = head;
+    }
+    p->rx_head = head;
+    
+    if (remaining < RX_DMA_REARM_THRESHOLD) {
+        // Bytes arriving meanwhile wait in the RX FIFO
+        dma_channel_set_trans_count(p->rx_dma_chan, RX_DMA_TRANSFER_COUNT, true);
+        p->rx_dma_remaining = RX_DMA_TRANSFER_COUNT;
+    }
+}
+
+#endif // GB_LINK_RX_DMA
+
+// =============================================================================
+// Transmit DMA
+// =============================================================================
+
+/**
+ * @brief Get the TX ring index the DMA channel will read next
+ * 
+ * The read address is left just past the last byte fetched and wraps with
+ * the ring, so it doubles as the consumer index.
+ */
+static uint16_t tx_ring_tail(const gb_link_port_state_t *p) {
+    return (uint16_t)(dma_channel_hw_addr(p->tx_dma_chan)->read_addr
+                      - (uintptr_t)s_tx_ring[p->index])
+           & (GB_TX_QUEUE_SIZE - 1);
+}
+
+/**
+ * @brief Get the number of bytes in the TX ring not yet fetched by DMA
+ */
+static uint16_t tx_ring_used(const gb_link_port_state_t *p) {
+    return (p->tx_head - tx_ring_tail(p)) & (GB_TX_QUEUE_SIZE - 1);
+}
+
+/**
+ * @brief Start a DMA transfer for everything queued, if none is running
+ * 
+ * Called with interrupts disabled by senders and from the DMA completion
+ * interrupt, so a transfer is restarted whenever bytes remain queued.
+ */
+static void tx_dma_kick(gb_link_port_state_t *p) {
+    if (dma_channel_is_busy(p->tx_dma_chan)) {
+        return;
+    }
+    
+    uint16_t used = tx_ring_used(p);
+    if (used > 0) {
+        // Continues from the current read address
+        dma_channel_set_trans_count(p->tx_dma_chan, used, true);
+    }
+}
+
+/**
+ * @brief TX DMA completion interrupt: chain on bytes queued meanwhile
+ */
+static void on_tx_dma_irq(void) {
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        gb_link_port_state_t *p = &s_ports[i];
+        
+        if (!p->active || !dma_channel_get_irq0_status(p->tx_dma_chan)) {
+            continue;
+        }
+        dma_channel_acknowledge_irq0(p->tx_dma_chan);
+        
+        tx_dma_kick(p);
+    }
+}
+
+/**
+ * @brief Claim and set up a port's TX DMA channel
+ * 
+ * Transfers are byte-wide: the bus replicates a byte write across the
+ * FIFO word, so the byte lands in bits 31:24 where the left-shifting OSR
+ * starts, with no per-byte CPU work to left-justify it.
+ */
+static bool tx_dma_start(gb_link_port_state_t *p) {
+    p->tx_dma_chan = dma_claim_unused_channel(false);
+    if (p->tx_dma_chan < 0) {
+        DEBUG_PRINT("GB Link: Failed to claim TX DMA channel\n");
+        return false;
+    }
+    
+    dma_channel_config c = dma_channel_get_default_config(p->tx_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_ring(&c, false, __builtin_ctz(sizeof(s_tx_ring[0])));
+    channel_config_set_dreq(&c, pio_get_dreq(p->pio, p->sm, true));
+    
+    dma_channel_configure(
+        p->tx_dma_chan,
+        &c,
+        &p->pio->txf[p->sm],            // Write to the SM's TX FIFO
+        s_tx_ring[p->index],            // Read from the port's ring
+        0,
+        false                           // Started by tx_dma_kick()
+    );
+    p->tx_head = 0;
+    
+    dma_channel_set_irq0_enabled(p->tx_dma_chan, true);
+    
+    return true;
+}
+
+/**
+ * @brief Drop all bytes queued on a port, leaving its TX DMA channel idle
+ */
+static void tx_queue_clear(gb_link_port_state_t *p) {
+    dma_channel_abort(p->tx_dma_chan);
+    dma_channel_set_read_addr(p->tx_dma_chan, s_tx_ring[p->index], false);
+    p->tx_head = 0;
+    pio_sm_clear_fifos(p->pio, p->sm);
+
+#if GB_LINK_TRACE
+    // Dropped bytes never reach the wire; their wire time stays 0
+    p->trace_done = p->trace_head;
+#endif
+}
+
+/**
+ * @brief Stop and release a port's TX DMA channel, dropping queued bytes
+ */
+static void tx_dma_stop(gb_link_port_state_t *p) {
+    if (p->tx_dma_chan < 0) {
+        return;
+    }
+    
+    dma_channel_set_irq0_enabled(p->tx_dma_chan, false);
+    dma_channel_abort(p->tx_dma_chan);
+    dma_channel_unclaim(p->tx_dma_chan);
+    p->tx_dma_chan = -1;
+}
+
+// =============================================================================
+// Idle Notification and Slave Reception
+// =============================================================================
+
+/**
+ * @brief Check whether everything queued on a port has been clocked out
+ * 
+ * The state machine must be stalled at its pull with an empty FIFO: the
+ * idle flag alone could be left over from before a byte that DMA fed in
+ * and the program picked up before this interrupt ran.
+ */
+static bool tx_idle(const gb_link_port_state_t *p) {
+    uint offset = s_programs[pio_get_index(p->pio)].txrx_offset;
+    
+    return tx_ring_used(p) == 0 &&
+           !dma_channel_is_busy(p->tx_dma_chan) &&
+           pio_sm_is_tx_fifo_empty(p->pio, p->sm) &&
+           pio_sm_get_pc(p->pio, p->sm) == offset + gb_link_txrx_wrap_target;
+}
+
+#if GB_LINK_TRACE
+/**
+ * @brief Stamp the wire time of every traced byte clocked out since last time
+ * 
+ * Bytes done are those DMA fetched from the ring, less the ones still in
+ * the TX FIFO and the one being shifted. Reading in this order can only
+ * undercount, which leaves a byte for the next flag.
+ */
+static void trace_stamp(gb_link_port_state_t *p) {
+    uint offset = s_programs[pio_get_index(p->pio)].txrx_offset;
+    uint32_t now = timer_hw->timerawl;
+    
+    uint32_t done = p->trace_head - tx_ring_used(p);
+    done -= pio_sm_get_tx_fifo_level(p->pio, p->sm);
+    if (gb_link_txrx_is_shifting(p->pio, p->sm, offset)) {
+        done--;
+    }
+    
+    if ((int32_t)(done - p->trace_done) > GB_LINK_TRACE_SIZE) {
+        p->trace_done = done - GB_LINK_TRACE_SIZE;
+    }
+    while ((int32_t)(done - p->trace_done) > 0) {
+        s_trace[p->index][p->trace_done & (GB_LINK_TRACE_SIZE - 1)].wire_us = now;
+        p->trace_done++;
+    }
+}
+#endif
+
+/**
+ * @brief Handle a master port's idle flag
+ */
+static void service_idle_flag(gb_link_port_state_t *p) {
+    uint flag = gb_link_txrx_idle_flag(p->sm);
+    if (!pio_interrupt_get(p->pio, flag)) {
+        return;
+    }
+    pio_interrupt_clear(p->pio, flag);
+
+#if GB_LINK_TRACE
+    trace_stamp(p);
+#endif
+    
+    if (!p->tx_busy || !tx_idle(p)) {
+        return;  // More bytes are on their way; their end raises the flag again
+    }
+    
+    p->tx_busy = false;
+    if (p->idle_callback) {
+        p->idle_callback(p->index);
+    }
+}
+
+/**
+ * @brief Move bytes clocked in by the Game Boy into a slave port's ring
+ */
+static void service_slave_rx(gb_link_port_state_t *p) {
+    uint8_t data;
+    
+    while (gb_link_txrx_try_get(p->pio, p->sm, &data)) {
+        uint32_t now = timer_hw->timerawl;
+        uint16_t next = (p->slave_rx_head + 1) & (GB_RX_BUFFER_SIZE - 1);
+        
+        p->rx_count++;
+        if (next == p->slave_rx_tail) {
+            p->rx_overrun_count++;
+            continue;
+        }
+        
+        s_slave_rx_data[p->index][p->slave_rx_head] = data;
+        s_slave_rx_time[p->index][p->slave_rx_head] = now;
+        __dmb();
+        p->slave_rx_head = next;
+    }
+}
+
+/**
+ * @brief PIO interrupt, shared by all ports on both PIO blocks
+ */
+static void on_link_pio_irq(void) {
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        gb_link_port_state_t *p = &s_ports[i];
+        
+        if (!p->active) {
+            continue;
+        }
+        if (p->role == GB_LINK_ROLE_SLAVE) {
+            service_slave_rx(p);
+        } else {
+            service_idle_flag(p);
+        }
+    }
+}
+
+/**
+ * @brief Route a port's interrupt source for its role to the handler
+ */
+static void port_irq_enable(gb_link_port_state_t *p, bool enabled) {
+    enum pio_interrupt_source source = (p->role == GB_LINK_ROLE_SLAVE)
+        ? (enum pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + p->sm)
+        : (enum pio_interrupt_source)(pis_interrupt0 + gb_link_txrx_idle_flag(p->sm));
+    
+    if (enabled) {
+        pio_interrupt_clear(p->pio, gb_link_txrx_idle_flag(p->sm));
+        p->slave_rx_head = 0;
+        p->slave_rx_tail = 0;
+    }
+    p->tx_busy = false;
+    pio_set_irqn_source_enabled(p->pio, GB_LINK_PIO_IRQ_INDEX, source, enabled);
+}
+
+/**
+ * @brief Wait until the last byte queued on a port and its gap are done
+ * 
+ * Sleeps until the idle interrupt instead of spinning. Must not be called
+ * from interrupt context. As slave only the Game Boy can clock the bytes
+ * out, so this returns at once; see gb_link_tx_flush().
+ */
+static void wait_idle(const gb_link_port_state_t *p) {
+    while (p->tx_busy) {
+        __wfe();
+    }
+}
+
+/**
+ * @brief Reload a master port's gap, and optionally its clock, between bytes
+ * 
+ * Loading Y goes through the TX FIFO, so no data byte may be in it or on
+ * its way. Bytes can be queued from interrupt context (the mGB release
+ * alarm), which could refill the ring and kick the DMA right after
+ * wait_idle() returns; the reload is therefore only done once the port is
+ * found idle with interrupts disabled. Senders and the DMA completion
+ * interrupt, the only ones that start the TX DMA, cannot run until then.
+ */
+static void reload_timing(gb_link_port_state_t *p, bool set_clock) {
+    while (true) {
+        wait_idle(p);
+        
+        uint32_t irq_state = save_and_disable_interrupts();
+        if (tx_idle(p)) {
+            if (set_clock) {
+                gb_link_txrx_set_freq(p->pio, p->sm, (float)p->clock_hz);
+            }
+            gb_link_txrx_set_gap(p->pio, p->sm, gap_us_to_cycles(p, p->byte_gap_us));
+            restore_interrupts(irq_state);
+            return;
+        }
+        restore_interrupts(irq_state);
+    }
+}
+
+// =============================================================================
+// Port Lifecycle
+// =============================================================================
+
+/**
+ * @brief Load the programs into a PIO block unless its ports already did
+ */
+static bool programs_acquire(PIO pio) {
+    gb_link_pio_programs_t *prog = &s_programs[pio_get_index(pio)];
+    
+    if (prog->users > 0) {
+        prog->users++;
+        return true;
+    }
+    
+    // Load both programs, so roles can change without reloading
+    if (!pio_can_add_program(pio, &gb_link_txrx_program)) {
+        return false;
+    }
+    prog->txrx_offset = pio_add_program(pio, &gb_link_txrx_program);
+    
+    if (!pio_can_add_program(pio, &gb_link_slave_program)) {
+        pio_remove_program(pio, &gb_link_txrx_program, prog->txrx_offset);
+        return false;
+    }
+    prog->slave_offset = pio_add_program(pio, &gb_link_slave_program);
+    
+    uint irq_num = pio_get_irq_num(pio, GB_LINK_PIO_IRQ_INDEX);
+    irq_add_shared_handler(irq_num, on_link_pio_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(irq_num, true);
+    
+    prog->users = 1;
+    return true;
+}
+
+/**
+ * @brief Unload a PIO block's programs once its last port stops
+ */
+static void programs_release(PIO pio) {
+    gb_link_pio_programs_t *prog = &s_programs[pio_get_index(pio)];
+    
+    if (--prog->users > 0) {
+        return;
+    }
+    
+    irq_remove_handler(pio_get_irq_num(pio, GB_LINK_PIO_IRQ_INDEX), on_link_pio_irq);
+    pio_remove_program(pio, &gb_link_slave_program, prog->slave_offset);
+    pio_remove_program(pio, &gb_link_txrx_program, prog->txrx_offset);
+}
+
+/**
+ * @brief Claim a state machine on a PIO block that can hold the programs
+ */
+static bool claim_sm(gb_link_port_state_t *p, PIO pio) {
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0) {
+        return false;
+    }
+    
+    if (!programs_acquire(pio)) {
+        pio_sm_unclaim(pio, (uint)sm);
+        return false;
+    }
+    
+    p->pio = pio;
+    p->sm = (uint)sm;
+    return true;
+}
+
+/**
+ * @brief Start a port's state machine in its current role
+ */
+static void role_start(gb_link_port_state_t *p) {
+    const gb_link_pio_programs_t *prog = &s_programs[pio_get_index(p->pio)];
+    
+    if (p->role == GB_LINK_ROLE_SLAVE) {
+        gb_link_slave_program_init(p->pio, p->sm, prog->slave_offset,
+                                   p->pin_si, p->pin_sc, p->pin_so,
+                                   GB_LINK_SLAVE_FILL_BYTE);
+    } else {
+        gb_link_txrx_program_init(
+            p->pio,
+            p->sm,
+            prog->txrx_offset,
+            p->pin_si,              // Data to Game Boy
+            p->pin_sc,              // Clock
+            p->pin_so,              // Data from Game Boy
+            (float)p->clock_hz      // Bit rate
+        );
+        
+        // The program waits at its first pull, so Y can be loaded right away
+        gb_link_txrx_set_gap(p->pio, p->sm, gap_us_to_cycles(p, p->byte_gap_us));
+
+#if GB_LINK_TRACE
+        gb_link_txrx_set_flag_every_byte(p->pio, p->sm, true);
+#endif
+    }
+    
+    port_irq_enable(p, true);
+}
+
+/**
+ * @brief Stop a port's state machine and the interrupt of its role
+ */
+static void role_stop(gb_link_port_state_t *p) {
+    port_irq_enable(p, false);
+    pio_sm_set_enabled(p->pio, p->sm, false);
+}
+
+/**
+ * @brief Claim the resources of a port and start it
+ */
+static bool port_start(gb_link_port_state_t *p) {
+    // Take pio0 first, then pio1
+    if (!claim_sm(p, pio0) && !claim_sm(p, pio1)) {
+        DEBUG_PRINT("GB Link: No PIO state machine or program space for port %d\n",
+                    p->index + 1);
+        return false;
+    }
+    
+    p->tx_dma_chan = -1;
+#if GB_LINK_RX_DMA
+    p->rx_dma_chan = -1;
+#endif
+
+    role_start(p);
+    
+    bool ok = tx_dma_start(p);
+#if GB_LINK_RX_DMA
+    ok = ok && rx_dma_start(p);
+#endif
+    if (!ok) {
+        tx_dma_stop(p);
+        role_stop(p);
+        programs_release(p->pio);
+        pio_sm_unclaim(p->pio, p->sm);
+        return false;
+    }
+
+#if GB_LINK_RX_DMA
+    if (p->role == GB_LINK_ROLE_SLAVE) {
+        rx_dma_pause(p);
+    }
+#endif
+
+    p->tx_count = 0;
+    p->rx_count = 0;
+    p->rx_overrun_count = 0;
+#if GB_LINK_TRACE
+    p->trace_head = 0;
+    p->trace_done = 0;
+    p->trace_start = 0;
+#endif
+    p->active = true;
+    
+    DEBUG_PRINT("GB Link: Port %d on PIO%d SM%d as %s\n",
+                p->index + 1, (int)pio_get_index(p->pio), p->sm,
+                (p->role == GB_LINK_ROLE_SLAVE) ? "slave" : "master");
+    return true;
+}
+
+/**
+ * @brief Stop a port and release its resources
+ */
+static void port_stop(gb_link_port_state_t *p) {
+    // Let queued bytes go out rather than cutting a byte short
+    wait_idle(p);
+    
+    p->active = false;
+#if GB_LINK_RX_DMA
+    rx_dma_stop(p);
+#endif
+    tx_dma_stop(p);
+    
+    role_stop(p);
+    programs_release(p->pio);
+    pio_sm_unclaim(p->pio, p->sm);
+}
 
 // =============================================================================
 // Initialization
@@ -43,44 +818,31 @@ bool gb_link_init(void) {
         return true;  // Already initialized
     }
     
-    // Claim a state machine
-    int sm = pio_claim_unused_sm(s_pio, false);
-    if (sm < 0) {
-        // Try the other PIO
-        s_pio = pio1;
-        sm = pio_claim_unused_sm(s_pio, false);
-        if (sm < 0) {
-            DEBUG_PRINT("GB Link: Failed to claim PIO state machine\n");
-            return false;
-        }
+    for (uint8_t i = 0; i < GB_LINK_PORT_COUNT; i++) {
+        s_ports[i].index = i;
+        s_ports[i].pin_si = s_port_pins[i][0];
+        s_ports[i].pin_sc = s_port_pins[i][1];
+        s_ports[i].pin_so = s_port_pins[i][2];
     }
-    s_sm = (uint)sm;
     
-    // Load the PIO program
-    if (!pio_can_add_program(s_pio, &gb_link_tx_program)) {
-        DEBUG_PRINT("GB Link: Failed to add PIO program\n");
-        pio_sm_unclaim(s_pio, s_sm);
-        return false;
-    }
+    // One handler serves the TX DMA channels of all ports
+    irq_add_shared_handler(DMA_IRQ_0, on_tx_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
     
-    s_pio_offset = pio_add_program(s_pio, &gb_link_tx_program);
+    // Ports whose resources run out are left out; port 1 is required
+    s_port_count = 0;
+    while (s_port_count < GB_LINK_PORT_COUNT && port_start(&s_ports[s_port_count])) {
+        s_port_count++;
+    }
     
-    // Initialize the state machine
-    gb_link_tx_program_init(
-        s_pio, 
-        s_sm, 
-        s_pio_offset,
-        PIN_GB_SI,          // Data to Game Boy
-        PIN_GB_SC,          // Clock
-        GB_LINK_CLOCK_HZ    // Bit rate
-    );
+    if (s_port_count == 0) {
+        irq_remove_handler(DMA_IRQ_0, on_tx_dma_irq);
+        return false;
+    }
     
-    // Reset statistics
-    s_tx_count = 0;
     s_initialized = true;
     
-    DEBUG_PRINT("GB Link: Initialized on PIO%d SM%d\n", 
-                (s_pio == pio0) ? 0 : 1, s_sm);
+    DEBUG_PRINT("GB Link: Initialized %d of %d ports\n", s_port_count, GB_LINK_PORT_COUNT);
     
     return true;
 }
@@ -90,83 +852,505 @@ void gb_link_deinit(void) {
         return;
     }
     
-    // Disable and unclaim the state machine
-    pio_sm_set_enabled(s_pio, s_sm, false);
-    pio_remove_program(s_pio, &gb_link_tx_program, s_pio_offset);
-    pio_sm_unclaim(s_pio, s_sm);
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        port_stop(&s_ports[i]);
+    }
+    irq_remove_handler(DMA_IRQ_0, on_tx_dma_irq);
     
+    s_port_count = 0;
     s_initialized = false;
     
     DEBUG_PRINT("GB Link: Deinitialized\n");
 }
 
+uint8_t gb_link_get_port_count(void) {
+    return s_port_count;
+}
+
 // =============================================================================
 // Transmission
 // =============================================================================
 
-bool gb_link_send_byte(uint8_t data) {
-    if (!s_initialized) {
+bool gb_link_send_bytes(uint8_t port, const uint8_t *data, uint16_t length) {
+    gb_link_port_state_t *p = get_active_port(port);
+    if (p == NULL || data == NULL) {
+        return false;
+    }
+    
+    if (length > gb_link_tx_free(port)) {
         return false;
     }
     
-    if (gb_link_tx_try_put(s_pio, s_sm, data)) {
-        s_tx_count++;
+    volatile uint8_t *ring = s_tx_ring[port];
+    uint16_t head = p->tx_head;
+    for (uint16_t i = 0; i < length; i++) {
+        ring[head] = data[i];
+        head = (head + 1) & (GB_TX_QUEUE_SIZE - 1);
+    }
+    p->tx_count += length;
+
+#if GB_LINK_TRACE
+    uint32_t now = timer_hw->timerawl;
+    for (uint16_t i = 0; i < length; i++) {
+        gb_link_trace_entry_t *e =
+            &s_trace[port][(p->trace_head + i) & (GB_LINK_TRACE_SIZE - 1)];
+        e->queued_us = now;
+        e->wire_us = 0;
+        e->data = data[i];
+    }
+#endif
+    
+    // Publish the bytes, then make sure the DMA channel is running
+    __dmb();
+    uint32_t irq_state = save_and_disable_interrupts();
+    p->tx_head = head;
+#if GB_LINK_TRACE
+    p->trace_head += length;
+#endif
+    p->tx_busy = (p->role == GB_LINK_ROLE_MASTER);  // Only the master signals idle
+    tx_dma_kick(p);
+    restore_interrupts(irq_state);
+    
+    return true;
+}
+
+bool gb_link_send_byte(uint8_t port, uint8_t data) {
+    return gb_link_send_bytes(port, &data, 1);
+}
+
+void gb_link_send_byte_blocking(uint8_t port, uint8_t data) {
+    if (get_active_port(port) == NULL) {
+        return;
+    }
+    
+    while (!gb_link_send_bytes(port, &data, 1)) {
+        tight_loop_contents();
+    }
+}
+
+bool gb_link_tx_ready(uint8_t port) {
+    return gb_link_tx_free(port) > 0;
+}
+
+uint16_t gb_link_tx_free(uint8_t port) {
+    gb_link_port_state_t *p = get_active_port(port);
+    if (p == NULL) {
+        return 0;
+    }
+    
+    return (GB_TX_QUEUE_SIZE - 1) - tx_ring_used(p);
+}
+
+uint16_t gb_link_tx_pending(uint8_t port) {
+    gb_link_port_state_t *p = get_active_port(port);
+    if (p == NULL) {
+        return 0;
+    }
+    
+    // Bytes still in the ring plus those already in the 4-entry PIO FIFO
+    return tx_ring_used(p) + pio_sm_get_tx_fifo_level(p->pio, p->sm);
+}
+
+void gb_link_tx_flush(uint8_t port) {
+    gb_link_port_state_t *p = get_active_port(port);
+    if (p == NULL) {
+        return;
+    }
+    
+    if (p->role == GB_LINK_ROLE_SLAVE) {
+        // The Game Boy sets the pace; wait until it has taken every byte
+        while (gb_link_tx_pending(port) > 0) {
+            tight_loop_contents();
+        }
+        return;
+    }
+    
+    // Wait for the ring and FIFO to drain and the last byte and gap to finish
+    wait_idle(p);
+}
+
+bool gb_link_is_idle(uint8_t port) {
+    gb_link_port_state_t *p = get_active_port(port);
+    if (p == NULL) {
         return true;
     }
     
-    return false;
+    if (p->role == GB_LINK_ROLE_SLAVE) {
+        return gb_link_tx_pending(port) == 0;
+    }
+    return !p->tx_busy;
 }
 
-void gb_link_send_byte_blocking(uint8_t data) {
-    if (!s_initialized) {
+void gb_link_set_idle_callback(uint8_t port, gb_link_idle_callback_t callback) {
+    gb_link_port_state_t *p = get_port(port);
+    if (p != NULL) {
+        p->idle_callback = callback;
+    }
+}
+
+void gb_link_set_byte_gap_us(uint8_t port, uint32_t gap_us) {
+    gb_link_port_state_t *p = get_port(port);
+    if (p == NULL) {
         return;
     }
+    p->byte_gap_us = gap_us;
     
-    gb_link_tx_put_blocking(s_pio, s_sm, data);
-    s_tx_count++;
+    if (!p->active || p->role != GB_LINK_ROLE_MASTER) {
+        return;  // Applied when the port starts or returns to master role
+    }
+    
+    // Y may only change between bytes
+    reload_timing(p, false);
 }
 
-bool gb_link_tx_ready(void) {
-    if (!s_initialized) {
+uint32_t gb_link_get_byte_gap_us(uint8_t port) {
+    gb_link_port_state_t *p = get_port(port);
+    return (p != NULL) ? p->byte_gap_us : 0;
+}
+
+// =============================================================================
+// Clock Rate
+// =============================================================================
+
+void gb_link_set_clock_hz(uint8_t port, uint32_t clock_hz) {
+    gb_link_port_state_t *p = get_port(port);
+    if (p == NULL) {
+        return;
+    }
+    
+    if (clock_hz < GB_LINK_MIN_CLOCK_HZ) {
+        clock_hz = GB_LINK_MIN_CLOCK_HZ;
+    } else if (clock_hz > GB_LINK_MAX_CLOCK_HZ) {
+        clock_hz = GB_LINK_MAX_CLOCK_HZ;
+    }
+    p->clock_hz = clock_hz;
+    
+    if (!p->active || p->role != GB_LINK_ROLE_MASTER) {
+        return;  // Applied when the port starts or returns to master role
+    }
+    
+    // Only change the rate between bytes; the gap is counted in PIO
+    // cycles, so it is reloaded to keep the same length in µs
+    reload_timing(p, true);
+}
+
+uint32_t gb_link_get_clock_hz(uint8_t port) {
+    gb_link_port_state_t *p = get_port(port);
+    return (p != NULL) ? p->clock_hz : 0;
+}
+
+bool gb_link_select_profile(uint8_t port, gb_link_profile_t profile) {
+    gb_link_port_state_t *p = get_port(port);
+    if (p == NULL || profile >= GB_LINK_PROFILE_COUNT) {
         return false;
     }
     
-    return gb_link_tx_fifo_has_space(s_pio, s_sm);
+    p->profile = profile;
+    gb_link_set_clock_hz(port, s_profiles[profile].clock_hz);
+    return true;
 }
 
-uint8_t gb_link_tx_pending(void) {
-    if (!s_initialized) {
+gb_link_profile_t gb_link_get_profile(uint8_t port) {
+    gb_link_port_state_t *p = get_port(port);
+    return (p != NULL) ? p->profile : GB_LINK_PROFILE_DMG_MGB;
+}
+
+const gb_link_clock_profile_t *gb_link_get_profile_info(gb_link_profile_t profile) {
+    if (profile >= GB_LINK_PROFILE_COUNT) {
+        return NULL;
+    }
+    return &s_profiles[profile];
+}
+
+/**
+ * @brief Send the calibration pattern at the current rate and check the echo
+ * 
+ * Bytes are sent one at a time so the echo can be read back even without
+ * the RX ring. An SI-SO loopback returns each byte as it is sent; a Game
+ * Boy that leaves SB alone shifts out the byte it received last time, so
+ * the echo lags by one byte. Either form counts as a pass.
+ */
+static bool calibration_pass(gb_link_port_state_t *p) {
+    uint8_t discard;
+    while (gb_link_receive_byte(p->index, &discard)) {
+        // Drop anything left over
+    }
+    
+    bool loopback_ok = true;
+    bool lagged_ok = true;
+    uint8_t prev = 0;
+    
+    for (uint32_t pass = 0; pass < GB_LINK_CALIBRATION_PASSES; pass++) {
+        for (size_t i = 0; i < sizeof(s_cal_pattern); i++) {
+            uint8_t sent = s_cal_pattern[i];
+            uint8_t echo;
+            
+            gb_link_send_byte_blocking(p->index, sent);
+            wait_idle(p);
+            if (!gb_link_receive_byte(p->index, &echo)) {
+                return false;
+            }
+            
+            loopback_ok = loopback_ok && (echo == sent);
+            if (pass > 0 || i > 0) {
+                lagged_ok = lagged_ok && (echo == prev);
+            }
+            prev = sent;
+            
+            if (!loopback_ok && !lagged_ok) {
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+uint32_t gb_link_calibrate(uint8_t port, uint32_t min_hz, uint32_t max_hz) {
+    gb_link_port_state_t *p = get_active_port(port);
+    if (p == NULL || p->role != GB_LINK_ROLE_MASTER ||
+        min_hz == 0 || min_hz > max_hz) {
+        return 0;
+    }
+    
+    uint32_t saved_hz = p->clock_hz;
+    uint32_t best_hz = 0;
+    uint32_t hz = min_hz;
+    
+    // Step up by 25% until the echo breaks, then settle on the last good rate
+    while (true) {
+        gb_link_set_clock_hz(port, hz);
+        if (!calibration_pass(p)) {
+            break;
+        }
+        best_hz = p->clock_hz;
+        
+        if (hz >= max_hz) {
+            break;
+        }
+        uint32_t next = hz + hz / 4;
+        hz = (next > max_hz || next <= hz) ? max_hz : next;
+    }
+    
+    DEBUG_PRINT("GB Link: Port %d calibration %s, %lu Hz\n", port + 1,
+                best_hz ? "passed" : "failed", (unsigned long)best_hz);
+    
+    if (best_hz == 0) {
+        gb_link_set_clock_hz(port, saved_hz);
         return 0;
     }
     
-    // PIO FIFO depth is 4 for TX
-    // We can check the FIFO level
-    return pio_sm_get_tx_fifo_level(s_pio, s_sm);
+    s_profiles[GB_LINK_PROFILE_CALIBRATED].clock_hz = best_hz;
+    gb_link_select_profile(port, GB_LINK_PROFILE_CALIBRATED);
+    return best_hz;
 }
 
-void gb_link_tx_flush(void) {
-    if (!s_initialized) {
-        return;
+// =============================================================================
+// Clock Role
+// =============================================================================
+
+bool gb_link_set_role(uint8_t port, gb_link_role_t role) {
+    gb_link_port_state_t *p = get_port(port);
+    if (p == NULL || role >= GB_LINK_ROLE_COUNT) {
+        return false;
     }
     
-    // Wait for FIFO to drain
-    while (!pio_sm_is_tx_fifo_empty(s_pio, s_sm)) {
-        tight_loop_contents();
+    if (!p->active) {
+        p->role = role;  // Applied when the port starts
+        return true;
     }
     
-    // Also wait for the current byte to finish transmitting
-    // Each byte takes approximately 8 * (1/8000) = 1ms plus inter-byte delay
-    sleep_us(2000);
+    if (role == p->role) {
+        return true;
+    }
+    
+    // As master, finish what is queued; as slave, unsent bytes are dropped.
+    // Interrupts stay off until the new program has its gap, so no sender
+    // can feed the TX FIFO in between (see reload_timing()).
+    wait_idle(p);
+    uint32_t irq_state = save_and_disable_interrupts();
+    role_stop(p);
+    tx_queue_clear(p);
+    
+    p->role = role;
+
+#if GB_LINK_RX_DMA
+    // Unread bytes of the old role are dropped with the ring
+    if (role == GB_LINK_ROLE_SLAVE) {
+        rx_dma_pause(p);
+    }
+#endif
+
+    role_start(p);
+
+#if GB_LINK_RX_DMA
+    if (role == GB_LINK_ROLE_MASTER) {
+        rx_dma_resume(p);
+    }
+#endif
+    restore_interrupts(irq_state);
+    
+    DEBUG_PRINT("GB Link: Port %d switched to %s role\n", port + 1,
+                (role == GB_LINK_ROLE_SLAVE) ? "slave" : "master");
+    return true;
+}
+
+gb_link_role_t gb_link_get_role(uint8_t port) {
+    gb_link_port_state_t *p = get_port(port);
+    return (p != NULL) ? p->role : GB_LINK_ROLE_MASTER;
+}
+
+// =============================================================================
+// Reception
+// =============================================================================
+
+/**
+ * @brief Take the next byte from a port's slave receive ring
+ */
+static bool slave_receive_byte(gb_link_port_state_t *p, uint8_t *data, uint32_t *time_us) {
+    if (p->slave_rx_tail == p->slave_rx_head) {
+        return false;
+    }
+    
+    *data = s_slave_rx_data[p->index][p->slave_rx_tail];
+    if (time_us != NULL) {
+        *time_us = s_slave_rx_time[p->index][p->slave_rx_tail];
+    }
+    __dmb();
+    p->slave_rx_tail = (p->slave_rx_tail + 1) & (GB_RX_BUFFER_SIZE - 1);
+    return true;
+}
+
+bool gb_link_rx_available(uint8_t port) {
+    gb_link_port_state_t *p = get_active_port(port);
+    if (p == NULL) {
+        return false;
+    }
+    
+    if (p->role == GB_LINK_ROLE_SLAVE) {
+        return p->slave_rx_tail != p->slave_rx_head;
+    }
+
+#if GB_LINK_RX_DMA
+    rx_dma_update_head(p);
+    return p->rx_tail != p->rx_head;
+#else
+    return !pio_sm_is_rx_fifo_empty(p->pio, p->sm);
+#endif
+}
+
+bool gb_link_receive_byte(uint8_t port, uint8_t *data) {
+    gb_link_port_state_t *p = get_active_port(port);
+    if (p == NULL || data == NULL) {
+        return false;
+    }
+    
+    if (p->role == GB_LINK_ROLE_SLAVE) {
+        return slave_receive_byte(p, data, NULL);
+    }
+
+#if GB_LINK_RX_DMA
+    if (p->rx_tail == p->rx_head) {
+        rx_dma_update_head(p);
+        if (p->rx_tail == p->rx_head) {
+            return false;
+        }
+    }
+    
+    *data = s_rx_buffer[port][p->rx_tail];
+    p->rx_tail = (p->rx_tail + 1) & (GB_RX_BUFFER_SIZE - 1);
+    return true;
+#else
+    if (!gb_link_txrx_try_get(p->pio, p->sm, data)) {
+        return false;
+    }
+    p->rx_count++;
+    return true;
+#endif
+}
+
+bool gb_link_receive_byte_timed(uint8_t port, uint8_t *data, uint32_t *time_us) {
+    gb_link_port_state_t *p = get_active_port(port);
+    if (p == NULL || data == NULL || time_us == NULL) {
+        return false;
+    }
+    
+    if (p->role == GB_LINK_ROLE_SLAVE) {
+        return slave_receive_byte(p, data, time_us);
+    }
+    
+    // As master the byte arrived while we clocked out one of ours
+    *time_us = 0;
+    return gb_link_receive_byte(port, data);
 }
 
 // =============================================================================
 // Statistics
 // =============================================================================
 
-uint32_t gb_link_get_tx_count(void) {
-    return s_tx_count;
+uint32_t gb_link_get_tx_count(uint8_t port) {
+    gb_link_port_state_t *p = get_port(port);
+    return (p != NULL) ? p->tx_count : 0;
+}
+
+uint32_t gb_link_get_rx_count(uint8_t port) {
+    gb_link_port_state_t *p = get_port(port);
+    return (p != NULL) ? p->rx_count : 0;
+}
+
+uint32_t gb_link_get_rx_overrun_count(uint8_t port) {
+    gb_link_port_state_t *p = get_port(port);
+    return (p != NULL) ? p->rx_overrun_count : 0;
 }
 
 void gb_link_reset_stats(void) {
-    s_tx_count = 0;
+    for (uint8_t i = 0; i < GB_LINK_PORT_COUNT; i++) {
+        s_ports[i].tx_count = 0;
+        s_ports[i].rx_count = 0;
+        s_ports[i].rx_overrun_count = 0;
+    }
+}
+
+// =============================================================================
+// Transmit Trace
+// =============================================================================
+
+uint16_t gb_link_trace_read(uint8_t port, gb_link_trace_entry_t *entries,
+                            uint16_t max_entries) {
+#if GB_LINK_TRACE
+    gb_link_port_state_t *p = get_port(port);
+    if (p == NULL || entries == NULL) {
+        return 0;
+    }
+    
+    uint32_t head = p->trace_head;
+    uint32_t count = head - p->trace_start;
+    if (count > GB_LINK_TRACE_SIZE) {
+        count = GB_LINK_TRACE_SIZE;
+    }
+    if (count > max_entries) {
+        count = max_entries;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        entries[i] = s_trace[port][(head - count + i) & (GB_LINK_TRACE_SIZE - 1)];
+    }
+    return (uint16_t)count;
+#else
+    (void)port;
+    (void)entries;
+    (void)max_entries;
+    return 0;
+#endif
+}
+
+void gb_link_trace_clear(uint8_t port) {
+#if GB_LINK_TRACE
+    gb_link_port_state_t *p = get_port(port);
+    if (p != NULL) {
+        p->trace_start = p->trace_head;
+    }
+#else
+    (void)port;
+#endif
 }
@@ -0,0 +1,335 @@
+/**
+ * @file link_capture.c
+ * @brief On-device logic analyzer for Game Boy link timing
+ * 
+ * A state machine running link_capture.pio samples SI, SC and SO at
+ * LINK_CAPTURE_SAMPLE_HZ and a DMA channel moves the packed samples into
+ * a RAM buffer. The analysis walks the samples once, tracking SC edges:
+ * - falling to falling edge within a byte: bit period
+ * - falling to rising edge: clock low time
+ * - last SI change to rising edge: data setup time
+ * - 8th rising edge to the next falling edge: gap between bytes
+ * and shifts in SI and SO at every rising edge to decode the bytes.
+ */
+
+#include "link_capture.h"
+#include "config.h"
+
+#if LINK_CAPTURE_ENABLED
+
+#include "gb_link.h"
+#include "link_capture.pio.h"
+
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "pico/stdlib.h"
+
+#include <string.h>
+
+// =============================================================================
+// Private State
+// =============================================================================
+
+// Packed samples, 8 per word, oldest in the low nibble
+static uint32_t s_buffer[LINK_CAPTURE_BUFFER_WORDS];
+
+// Resources of the running capture
+static PIO  s_pio;
+static uint s_sm;
+static uint s_offset;
+static int  s_dma_chan = -1;
+static bool s_armed = false;
+
+// Words captured by the last capture, set when it stops
+static uint32_t s_words = 0;
+
+// Samples per buffer word (4 bits each)
+#define SAMPLES_PER_WORD    8u
+
+// Sample bits
+#define SAMPLE_SI           0x1u
+#define SAMPLE_SC           0x2u
+#define SAMPLE_SO           0x4u
+
+// Pins of each GB link port: { SI, SC, SO }
+static const uint8_t s_port_pins[][3] = GB_LINK_PORT_PINS;
+
+// Benchmark message: Note Off, ignored by a silent mGB channel
+static const uint8_t s_bench_message[] = { 0x80, 0x3C, 0x00 };
+
+/**
+ * @brief Running min/max/sum of one measurement, in samples
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} timing_acc_t;
+
+// =============================================================================
+// Helper Functions
+// =============================================================================
+
+static void timing_add(timing_acc_t *acc, uint32_t samples) {
+    if (acc->count == 0 || samples < acc->min) {
+        acc->min = samples;
+    }
+    if (samples > acc->max) {
+        acc->max = samples;
+    }
+    acc->sum += samples;
+    acc->count++;
+}
+
+/**
+ * @brief Convert an accumulator from samples to nanoseconds
+ */
+static void timing_finish(const timing_acc_t *acc, link_capture_timing_t *out) {
+    const uint64_t ns_per_sample_x = 1000000000ull;
+    
+    out->count = acc->count;
+    if (acc->count == 0) {
+        out->min_ns = out->max_ns = out->avg_ns = 0;
+        return;
+    }
+    out->min_ns = (uint32_t)(acc->min * ns_per_sample_x / LINK_CAPTURE_SAMPLE_HZ);
+    out->max_ns = (uint32_t)(acc->max * ns_per_sample_x / LINK_CAPTURE_SAMPLE_HZ);
+    out->avg_ns = (uint32_t)(acc->sum * ns_per_sample_x
+                             / ((uint64_t)acc->count * LINK_CAPTURE_SAMPLE_HZ));
+}
+
+/**
+ * @brief Claim a state machine and load the program on one PIO block
+ */
+static bool claim_pio(PIO pio) {
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0) {
+        return false;
+    }
+    
+    if (!pio_can_add_program(pio, &link_capture_program)) {
+        pio_sm_unclaim(pio, (uint)sm);
+        return false;
+    }
+    
+    s_pio = pio;
+    s_sm = (uint)sm;
+    s_offset = pio_add_program(pio, &link_capture_program);
+    return true;
+}
+
+// =============================================================================
+// Capture
+// =============================================================================
+
+bool link_capture_start(uint8_t port) {
+    if (s_armed || port >= GB_LINK_PORT_COUNT) {
+        return false;
+    }
+    
+    uint pin_si = s_port_pins[port][0];
+    if (s_port_pins[port][1] != pin_si + 1 || s_port_pins[port][2] != pin_si + 2) {
+        DEBUG_PRINT("Capture: Port %d pins are not consecutive\n", port + 1);
+        return false;
+    }
+    
+    if (!claim_pio(pio0) && !claim_pio(pio1)) {
+        DEBUG_PRINT("Capture: No PIO state machine or program space\n");
+        return false;
+    }
+    
+    s_dma_chan = dma_claim_unused_channel(false);
+    if (s_dma_chan < 0) {
+        DEBUG_PRINT("Capture: Failed to claim DMA channel\n");
+        pio_remove_program(s_pio, &link_capture_program, s_offset);
+        pio_sm_unclaim(s_pio, s_sm);
+        return false;
+    }
+    
+    link_capture_program_init(s_pio, s_sm, s_offset, pin_si, LINK_CAPTURE_SAMPLE_HZ);
+    
+    dma_channel_config c = dma_channel_get_default_config(s_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(s_pio, s_sm, false));
+    
+    dma_channel_configure(
+        s_dma_chan,
+        &c,
+        s_buffer,                       // Write into the capture buffer
+        &s_pio->rxf[s_sm],              // Read from the SM's RX FIFO
+        LINK_CAPTURE_BUFFER_WORDS,
+        true                            // Start immediately
+    );
+    
+    s_words = 0;
+    s_armed = true;
+    pio_sm_set_enabled(s_pio, s_sm, true);
+    
+    return true;
+}
+
+bool link_capture_is_done(void) {
+    return !s_armed || !dma_channel_is_busy(s_dma_chan);
+}
+
+void link_capture_stop(void) {
+    if (!s_armed) {
+        return;
+    }
+    
+    pio_sm_set_enabled(s_pio, s_sm, false);
+    dma_channel_abort(s_dma_chan);
+    s_words = LINK_CAPTURE_BUFFER_WORDS - dma_channel_hw_addr(s_dma_chan)->transfer_count;
+    
+    dma_channel_unclaim(s_dma_chan);
+    s_dma_chan = -1;
+    pio_remove_program(s_pio, &link_capture_program, s_offset);
+    pio_sm_unclaim(s_pio, s_sm);
+    s_armed = false;
+}
+
+// =============================================================================
+// Analysis
+// =============================================================================
+
+bool link_capture_analyze(link_capture_stats_t *stats) {
+    if (stats == NULL) {
+        return false;
+    }
+    
+    link_capture_stop();
+    
+    memset(stats, 0, sizeof(*stats));
+    stats->sample_hz = LINK_CAPTURE_SAMPLE_HZ;
+    stats->samples = s_words * SAMPLES_PER_WORD;
+    if (stats->samples == 0) {
+        return false;
+    }
+    
+    timing_acc_t bit_period = {0};
+    timing_acc_t clock_low = {0};
+    timing_acc_t si_setup = {0};
+    timing_acc_t byte_gap = {0};
+    
+    // The capture triggers on SC low, so start as if SC was idle HIGH
+    uint32_t prev = SAMPLE_SC | (s_buffer[0] & SAMPLE_SI);
+    int32_t last_fall = -1;
+    int32_t last_rise = -1;
+    int32_t last_si_change = -1;
+    uint8_t bit = 0;
+    uint8_t si_byte = 0;
+    uint8_t so_byte = 0;
+    
+    for (uint32_t i = 0; i < stats->samples; i++) {
+        uint32_t s = (s_buffer[i / SAMPLES_PER_WORD] >> ((i % SAMPLES_PER_WORD) * 4)) & 0xF;
+        uint32_t changed = s ^ prev;
+        
+        if (changed & SAMPLE_SI) {
+            last_si_change = (int32_t)i;
+        }
+        
+        if ((changed & SAMPLE_SC) && !(s & SAMPLE_SC)) {
+            // Falling edge: next bit, or the first bit of a new byte
+            if (bit > 0 && last_fall >= 0) {
+                timing_add(&bit_period, i - (uint32_t)last_fall);
+            } else if (bit == 0 && last_rise >= 0) {
+                timing_add(&byte_gap, i - (uint32_t)last_rise);
+            }
+            last_fall = (int32_t)i;
+        } else if ((changed & SAMPLE_SC) && (s & SAMPLE_SC) && last_fall >= 0) {
+            // Rising edge: both sides sample
+            timing_add(&clock_low, i - (uint32_t)last_fall);
+            if (last_si_change > last_fall) {
+                timing_add(&si_setup, i - (uint32_t)last_si_change);
+            }
+            
+            si_byte = (uint8_t)((si_byte << 1) | ((s & SAMPLE_SI) ? 1 : 0));
+            so_byte = (uint8_t)((so_byte << 1) | ((s & SAMPLE_SO) ? 1 : 0));
+            last_rise = (int32_t)i;
+            
+            if (++bit == 8) {
+                if (stats->bytes < LINK_CAPTURE_MAX_DECODED) {
+                    stats->si_bytes[stats->bytes] = si_byte;
+                    stats->so_bytes[stats->bytes] = so_byte;
+                }
+                stats->bytes++;
+                bit = 0;
+            }
+        }
+        
+        prev = s;
+    }
+    
+    timing_finish(&bit_period, &stats->bit_period);
+    timing_finish(&clock_low, &stats->clock_low);
+    timing_finish(&si_setup, &stats->si_setup);
+    timing_finish(&byte_gap, &stats->byte_gap);
+    
+    return true;
+}
+
+// =============================================================================
+// Reporting
+// =============================================================================
+
+static void print_timing(const char *name, const link_capture_timing_t *t) {
+    DEBUG_PRINT("  %-10s n=%lu min %lu ns avg %lu ns max %lu ns jitter %lu ns\n",
+                name, (unsigned long)t->count, (unsigned long)t->min_ns,
+                (unsigned long)t->avg_ns, (unsigned long)t->max_ns,
+                (unsigned long)(t->max_ns - t->min_ns));
+}
+
+void link_capture_print(const link_capture_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    
+    DEBUG_PRINT("Capture: %lu samples at %lu Hz, %lu bytes\n",
+                (unsigned long)stats->samples, (unsigned long)stats->sample_hz,
+                (unsigned long)stats->bytes);
+    print_timing("bit", &stats->bit_period);
+    print_timing("clock low", &stats->clock_low);
+    print_timing("SI setup", &stats->si_setup);
+    print_timing("byte gap", &stats->byte_gap);
+    
+    uint32_t shown = (stats->bytes < LINK_CAPTURE_MAX_DECODED)
+                     ? stats->bytes : LINK_CAPTURE_MAX_DECODED;
+    for (uint32_t i = 0; i < shown; i++) {
+        DEBUG_PRINT("  byte %lu: SI %02X SO %02X\n", (unsigned long)i,
+                    stats->si_bytes[i], stats->so_bytes[i]);
+    }
+}
+
+bool link_capture_benchmark(uint8_t port, link_capture_stats_t *stats) {
+    link_capture_stats_t local;
+    if (stats == NULL) {
+        stats = &local;
+    }
+    
+    if (!link_capture_start(port)) {
+        return false;
+    }
+    
+    if (!gb_link_send_bytes(port, s_bench_message, sizeof(s_bench_message))) {
+        link_capture_stop();
+        return false;
+    }
+    gb_link_tx_flush(port);
+    
+    // Fill the rest of the buffer; give up if SC never moved
+    uint32_t timeout_us = (uint32_t)((uint64_t)LINK_CAPTURE_BUFFER_WORDS * SAMPLES_PER_WORD
+                                     * 1000000u / LINK_CAPTURE_SAMPLE_HZ) * 2;
+    uint32_t start = timer_hw->timerawl;
+    while (!link_capture_is_done() && (timer_hw->timerawl - start) < timeout_us) {
+        tight_loop_contents();
+    }
+    
+    link_capture_analyze(stats);
+    link_capture_print(stats);
+    return true;
+}
+
+#endif // LINK_CAPTURE_ENABLED
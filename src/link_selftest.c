@@ -0,0 +1,206 @@
+/**
+ * @file link_selftest.c
+ * @brief GB link loopback throughput and bit error rate benchmark
+ * 
+ * Bytes come from a xorshift32 generator with a fixed seed, so every run
+ * sends the same sequence and the receiver regenerates the expected bytes
+ * instead of storing them. The number of bytes in flight is capped so the
+ * echoes always fit in the receive buffer (the RX ring with
+ * GB_LINK_RX_DMA, otherwise the 4-entry PIO FIFO).
+ */
+
+#include "link_selftest.h"
+#include "gb_link.h"
+#include "config.h"
+
+#include "pico/stdlib.h"
+
+// =============================================================================
+// Private State
+// =============================================================================
+
+// Settings swept by link_selftest_run()
+static const uint32_t s_clocks_hz[] = LINK_SELFTEST_CLOCKS_HZ;
+static const uint32_t s_gaps_us[] = LINK_SELFTEST_GAPS_US;
+
+#define CLOCK_COUNT     (sizeof(s_clocks_hz) / sizeof(s_clocks_hz[0]))
+#define GAP_COUNT       (sizeof(s_gaps_us) / sizeof(s_gaps_us[0]))
+
+// Bytes in flight, limited by where the echoes wait to be read
+#if GB_LINK_RX_DMA
+#define WINDOW_SIZE     (GB_RX_BUFFER_SIZE / 2)
+#else
+#define WINDOW_SIZE     4
+#endif
+
+// Queue times of the bytes in flight, indexed by sequence number
+#define SEND_TIME_SIZE  GB_RX_BUFFER_SIZE
+static uint32_t s_send_time[SEND_TIME_SIZE];
+
+// Seed of the test sequence (any non-zero value)
+#define SEQUENCE_SEED   0x2545F491u
+
+// =============================================================================
+// Helper Functions
+// =============================================================================
+
+/**
+ * @brief Next byte of the test sequence (xorshift32)
+ */
+static uint8_t sequence_next(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (uint8_t)(x >> 24);
+}
+
+static uint32_t count_bits(uint8_t value) {
+    uint32_t count = 0;
+    while (value) {
+        value &= (uint8_t)(value - 1);
+        count++;
+    }
+    return count;
+}
+
+// =============================================================================
+// Public Functions
+// =============================================================================
+
+bool link_selftest_step(uint8_t port, uint32_t clock_hz, uint32_t gap_us,
+                        uint32_t bytes, link_selftest_result_t *result) {
+    if (result == NULL || port >= gb_link_get_port_count() ||
+        gb_link_get_role(port) != GB_LINK_ROLE_MASTER) {
+        return false;
+    }
+    
+    gb_link_set_clock_hz(port, clock_hz);
+    gb_link_set_byte_gap_us(port, gap_us);
+    
+    // Start from an empty link
+    gb_link_tx_flush(port);
+    uint8_t discard;
+    while (gb_link_receive_byte(port, &discard)) {
+        // Drop anything left over
+    }
+    
+    uint32_t tx_state = SEQUENCE_SEED;
+    uint32_t rx_state = SEQUENCE_SEED;
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    uint32_t bit_errors = 0;
+    uint32_t max_latency = 0;
+    uint64_t total_latency = 0;
+    
+    uint32_t start = time_us_32();
+    uint32_t last_progress = start;
+    
+    while (received < bytes) {
+        uint32_t now = time_us_32();
+        
+        // Keep the window full
+        while (sent < bytes && sent - received < WINDOW_SIZE) {
+            s_send_time[sent & (SEND_TIME_SIZE - 1)] = time_us_32();
+            if (!gb_link_send_byte(port, sequence_next(&tx_state))) {
+                break;
+            }
+            sent++;
+        }
+        
+        uint8_t echo;
+        if (gb_link_receive_byte(port, &echo)) {
+            now = time_us_32();
+            uint32_t latency = now - s_send_time[received & (SEND_TIME_SIZE - 1)];
+            if (latency > max_latency) {
+                max_latency = latency;
+            }
+            total_latency += latency;
+            
+            bit_errors += count_bits(echo ^ sequence_next(&rx_state));
+            received++;
+            last_progress = now;
+        } else if (now - last_progress > LINK_SELFTEST_TIMEOUT_MS * 1000u) {
+            break;  // Echoes stopped: no jumper, or bytes dropped
+        }
+    }
+    
+    uint32_t elapsed = time_us_32() - start;
+    
+    // The rest of the sequence is lost; let it finish before moving on
+    gb_link_tx_flush(port);
+    while (gb_link_receive_byte(port, &discard)) {
+        // Drop late echoes
+    }
+    
+    result->clock_hz = gb_link_get_clock_hz(port);
+    result->gap_us = gap_us;
+    result->bytes_sent = bytes;
+    result->bytes_received = received;
+    result->bit_errors = bit_errors + (bytes - received) * 8;
+    result->elapsed_us = elapsed;
+    result->throughput_bps = elapsed ? (uint32_t)((uint64_t)received * 8 * 1000000u / elapsed) : 0;
+    result->max_latency_us = max_latency;
+    result->avg_latency_us = received ? (uint32_t)(total_latency / received) : 0;
+    
+    return true;
+}
+
+uint32_t link_selftest_run(uint8_t port, link_selftest_result_t *results,
+                           uint32_t max_results) {
+    if (port >= gb_link_get_port_count() ||
+        gb_link_get_role(port) != GB_LINK_ROLE_MASTER) {
+        return 0;
+    }
+    
+    uint32_t saved_hz = gb_link_get_clock_hz(port);
+    uint32_t saved_gap = gb_link_get_byte_gap_us(port);
+    uint32_t count = 0;
+    
+    DEBUG_PRINT("Self-test: Port %d loopback, %d bytes per setting\n",
+                port + 1, LINK_SELFTEST_BYTES);
+    
+    for (size_t c = 0; c < CLOCK_COUNT; c++) {
+        for (size_t g = 0; g < GAP_COUNT; g++) {
+            link_selftest_result_t result;
+            if (!link_selftest_step(port, s_clocks_hz[c], s_gaps_us[g],
+                                    LINK_SELFTEST_BYTES, &result)) {
+                continue;
+            }
+            
+            link_selftest_print(&result);
+            if (results != NULL && count < max_results) {
+                results[count] = result;
+            }
+            count++;
+        }
+    }
+    
+    gb_link_set_clock_hz(port, saved_hz);
+    gb_link_set_byte_gap_us(port, saved_gap);
+    
+    return count;
+}
+
+void link_selftest_print(const link_selftest_result_t *result) {
+#if DEBUG_ENABLED
+    if (result == NULL) {
+        return;
+    }
+    
+    // Bit error rate in errors per million bits
+    uint32_t bits = result->bytes_sent * 8;
+    uint32_t ber_ppm = bits ? (uint32_t)((uint64_t)result->bit_errors * 1000000u / bits) : 0;
+    
+    DEBUG_PRINT("  %7lu Hz gap %4lu us: %6lu bit/s, %lu/%lu bytes, "
+                "%lu bit errors (%lu ppm), latency avg %lu us max %lu us\n",
+                (unsigned long)result->clock_hz, (unsigned long)result->gap_us,
+                (unsigned long)result->throughput_bps,
+                (unsigned long)result->bytes_received, (unsigned long)result->bytes_sent,
+                (unsigned long)result->bit_errors, (unsigned long)ber_ppm,
+                (unsigned long)result->avg_latency_us, (unsigned long)result->max_latency_us);
+#else
+    (void)result;
+#endif
+}
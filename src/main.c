@@ -22,8 +22,11 @@
 #include "config.h"
 #include "led.h"
 #include "gb_link.h"
+#include "midi_uart.h"
 #include "usb_midi.h"
 #include "mode_mgb.h"
+#include "link_capture.h"
+#include "link_selftest.h"
 
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
@@ -93,8 +96,39 @@ static void print_status(void) {
     
     printf("\n--- MIDIBoy Status ---\n");
     printf("Mode: mGB MIDI IN\n");
-    printf("MIDI msgs forwarded: %lu\n", mode_mgb_get_forward_count());
-    printf("GB bytes sent: %lu\n", gb_link_get_tx_count());
+    printf("MIDI msgs forwarded: %lu (DIN %lu, USB %lu), dropped: DIN %lu, USB %lu\n",
+           mode_mgb_get_forward_count(),
+           mode_mgb_get_source_forward_count(MGB_SOURCE_DIN),
+           mode_mgb_get_source_forward_count(MGB_SOURCE_USB),
+           mode_mgb_get_source_drop_count(MGB_SOURCE_DIN),
+           mode_mgb_get_source_drop_count(MGB_SOURCE_USB));
+    printf("Controller updates coalesced: %lu (stale backlog %lu), status bytes saved: %lu\n",
+           mode_mgb_get_coalesced_count(), mode_mgb_get_stale_update_count(),
+           mode_mgb_get_running_status_saved_count());
+    static const char *const class_names[MGB_CLASS_COUNT] = { "note", "program", "controller" };
+    for (uint8_t cls = 0; cls < MGB_CLASS_COUNT; cls++) {
+        mgb_queue_delay_t delay;
+        mode_mgb_get_queue_delay((mgb_class_t)cls, &delay);
+        printf("GB queue delay (%s): %lu msgs, avg %lu us, max %lu us\n",
+               class_names[cls], delay.count, delay.avg_us, delay.max_us);
+    }
+    for (uint8_t port = 0; port < midi_uart_get_port_count(); port++) {
+        midi_uart_port_stats_t stats;
+        midi_uart_get_port_stats(port, &stats);
+        printf("DIN IN %u: %lu msgs, %lu framing errors, %lu RX IRQs\n",
+               port + 1, stats.message_count, stats.framing_error_count,
+               stats.irq_count);
+    }
+    for (uint8_t port = 0; port < gb_link_get_port_count(); port++) {
+        printf("GB %u: %lu bytes sent, clock %lu Hz (%s)\n", port + 1,
+               gb_link_get_tx_count(port), gb_link_get_clock_hz(port),
+               gb_link_get_profile_info(gb_link_get_profile(port))->name);
+    }
+    printf("MIDI->GB latency: last %lu us, max %lu us\n",
+           mode_mgb_get_latency_last_us(), mode_mgb_get_latency_max_us());
+    printf("DIN parse latency (%s): last %lu us, max %lu us\n",
+           MIDI_RX_PARSE_IN_ISR ? "ISR" : "main loop",
+           midi_uart_get_parse_latency_last_us(), midi_uart_get_parse_latency_max_us());
     printf("----------------------\n");
 }
 #else
@@ -134,6 +168,23 @@ int main(void) {
     
     sleep_ms(500);
     
+#if LINK_SELFTEST_AT_BOOT || LINK_CAPTURE_AT_BOOT
+    // Boot link tests own the link: run them before mGB mode arms its
+    // release alarm and inputs, which would also write to port 0.
+    // mode_mgb_init() then picks up the already initialized link.
+    if (gb_link_init()) {
+#if LINK_SELFTEST_AT_BOOT
+        // Loopback sweep on port 0 (needs the SI-SO jumper), then carry on
+        link_selftest_run(0, NULL, 0);
+#endif
+        
+#if LINK_CAPTURE_AT_BOOT
+        // Link timing benchmark: capture one message on the wire and report it
+        link_capture_benchmark(0, NULL);
+#endif
+    }
+#endif
+    
     // Initialize mGB mode (this sets up GB link and MIDI UART)
     if (!mode_mgb_init()) {
         // Error indication: fast blinking
@@ -0,0 +1,91 @@
+/**
+ * @file midi_codec.c
+ * @brief Table-driven MIDI status byte classification implementation
+ *
+ * The tables are built entirely by the preprocessor so they live in flash
+ * and cost nothing at startup.
+ */
+
+#include "midi_codec.h"
+
+// =============================================================================
+// Table Construction Helpers
+// =============================================================================
+
+#define F_STATUS    MIDI_CODEC_FLAG_STATUS
+#define F_CHANNEL   (MIDI_CODEC_FLAG_STATUS | MIDI_CODEC_FLAG_CHANNEL)
+#define F_REALTIME  (MIDI_CODEC_FLAG_STATUS | MIDI_CODEC_FLAG_REALTIME)
+
+#define ENTRY(type, len, flags, cin)    { (type), (len), (flags), (cin) }
+
+#define X4(...)     __VA_ARGS__, __VA_ARGS__, __VA_ARGS__, __VA_ARGS__
+#define X16(...)    X4(__VA_ARGS__), X4(__VA_ARGS__), X4(__VA_ARGS__), X4(__VA_ARGS__)
+#define X128(...)   X16(__VA_ARGS__), X16(__VA_ARGS__), X16(__VA_ARGS__), X16(__VA_ARGS__), \
+                    X16(__VA_ARGS__), X16(__VA_ARGS__), X16(__VA_ARGS__), X16(__VA_ARGS__)
+
+// One row per channel voice status nibble (16 channels each)
+#define CHANNEL_ROW(type, len, cin)     X16(ENTRY(type, len, F_CHANNEL, cin))
+
+// =============================================================================
+// Status Table
+// =============================================================================
+
+const midi_status_info_t midi_status_table[256] = {
+    // 0x00-0x7F: data bytes
+    X128(ENTRY(MIDI_MSG_NONE, 0, 0, 0x00)),
+
+    // 0x80-0xEF: channel voice messages
+    CHANNEL_ROW(MIDI_MSG_NOTE_OFF,          2, 0x08),
+    CHANNEL_ROW(MIDI_MSG_NOTE_ON,           2, 0x09),
+    CHANNEL_ROW(MIDI_MSG_POLY_PRESSURE,     2, 0x0A),
+    CHANNEL_ROW(MIDI_MSG_CONTROL_CHANGE,    2, 0x0B),
+    CHANNEL_ROW(MIDI_MSG_PROGRAM_CHANGE,    1, 0x0C),
+    CHANNEL_ROW(MIDI_MSG_CHANNEL_PRESSURE,  1, 0x0D),
+    CHANNEL_ROW(MIDI_MSG_PITCH_BEND,        2, 0x0E),
+
+    // 0xF0-0xF7: system common
+    ENTRY(MIDI_MSG_SYSEX_START,     MIDI_CODEC_LEN_SYSEX, F_STATUS, 0x04),  // 0xF0
+    ENTRY(MIDI_MSG_MTC_QUARTER,     1, F_STATUS, 0x02),                     // 0xF1
+    ENTRY(MIDI_MSG_SONG_POSITION,   2, F_STATUS, 0x03),                     // 0xF2
+    ENTRY(MIDI_MSG_SONG_SELECT,     1, F_STATUS, 0x02),                     // 0xF3
+    ENTRY(MIDI_MSG_NONE,            0, F_STATUS, 0x00),                     // 0xF4 (undefined)
+    ENTRY(MIDI_MSG_NONE,            0, F_STATUS, 0x00),                     // 0xF5 (undefined)
+    ENTRY(MIDI_MSG_TUNE_REQUEST,    0, F_STATUS, 0x05),                     // 0xF6
+    ENTRY(MIDI_MSG_SYSEX_END,       0, F_STATUS, 0x05),                     // 0xF7
+
+    // 0xF8-0xFF: system real-time
+    ENTRY(MIDI_MSG_CLOCK,           0, F_REALTIME, 0x0F),                   // 0xF8
+    ENTRY(MIDI_MSG_NONE,            0, F_REALTIME, 0x0F),                   // 0xF9 (undefined)
+    ENTRY(MIDI_MSG_START,           0, F_REALTIME, 0x0F),                   // 0xFA
+    ENTRY(MIDI_MSG_CONTINUE,        0, F_REALTIME, 0x0F),                   // 0xFB
+    ENTRY(MIDI_MSG_STOP,            0, F_REALTIME, 0x0F),                   // 0xFC
+    ENTRY(MIDI_MSG_NONE,            0, F_REALTIME, 0x0F),                   // 0xFD (undefined)
+    ENTRY(MIDI_MSG_ACTIVE_SENSING,  0, F_REALTIME, 0x0F),                   // 0xFE
+    ENTRY(MIDI_MSG_SYSTEM_RESET,    0, F_REALTIME, 0x0F),                   // 0xFF
+};
+
+_Static_assert(sizeof(midi_status_table) / sizeof(midi_status_table[0]) == 256,
+               "midi_status_table must cover every byte value");
+
+// =============================================================================
+// USB-MIDI Code Index Table
+// =============================================================================
+
+const uint8_t midi_usb_cin_length[16] = {
+    0,  // 0x0: Miscellaneous (reserved)
+    0,  // 0x1: Cable events (reserved)
+    2,  // 0x2: Two-byte System Common
+    3,  // 0x3: Three-byte System Common
+    3,  // 0x4: SysEx starts or continues
+    1,  // 0x5: Single-byte System Common / SysEx ends with one byte
+    2,  // 0x6: SysEx ends with two bytes
+    3,  // 0x7: SysEx ends with three bytes
+    3,  // 0x8: Note Off
+    3,  // 0x9: Note On
+    3,  // 0xA: Poly Pressure
+    3,  // 0xB: Control Change
+    2,  // 0xC: Program Change
+    2,  // 0xD: Channel Pressure
+    3,  // 0xE: Pitch Bend
+    1,  // 0xF: Single byte
+};
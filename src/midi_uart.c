@@ -4,17 +4,60 @@
  * 
  * Implements interrupt-driven MIDI reception with a proper MIDI parser
  * that handles running status and all standard message types.
+ * 
+ * With MIDI_RX_BACKEND_DMA the UART RX FIFO is drained by a DMA channel
+ * in ring mode instead, so core 0 takes no per-byte interrupts at all.
+ * 
+ * Extra DIN inputs are PIO UART receivers (midi_uart_rx.pio) drained by
+ * the PIO interrupt. Each input port has its own receive ring, parser and
+ * counters; midi_uart_process() always parses the oldest pending byte
+ * across all ports next, so the merged message stream is in arrival order.
+ * 
+ * With MIDI_RX_PARSE_IN_ISR the parser runs inside the RX interrupts
+ * instead and the rings are bypassed; the interrupts are serviced in
+ * arrival order, so the ports still merge in order.
+ * 
+ * MIDI OUT is queued in a TX ring drained by the UART TX interrupt, with
+ * optional running status compression.
  */
 
 #include "midi_uart.h"
+#include "midi_codec.h"
 #include "config.h"
 
 #include "hardware/uart.h"
 #include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
 #include "pico/stdlib.h"
 
+#if MIDI_RX_BACKEND == MIDI_RX_BACKEND_DMA
+#include "hardware/dma.h"
+#endif
+
+#if MIDI_PIO_RX_PORT_COUNT > 0
+#include "hardware/pio.h"
+#include "midi_uart_rx.pio.h"
+#endif
+
 #include <string.h>
 
+_Static_assert((MIDI_RX_BUFFER_SIZE & (MIDI_RX_BUFFER_SIZE - 1)) == 0,
+               "MIDI_RX_BUFFER_SIZE must be a power of 2");
+_Static_assert(MIDI_RX_BACKEND == MIDI_RX_BACKEND_IRQ ||
+               MIDI_RX_BACKEND == MIDI_RX_BACKEND_DMA,
+               "MIDI_RX_BACKEND must be MIDI_RX_BACKEND_IRQ or MIDI_RX_BACKEND_DMA");
+_Static_assert((MIDI_TX_BUFFER_SIZE & (MIDI_TX_BUFFER_SIZE - 1)) == 0,
+               "MIDI_TX_BUFFER_SIZE must be a power of 2");
+_Static_assert((MIDI_RT_QUEUE_SIZE & (MIDI_RT_QUEUE_SIZE - 1)) == 0,
+               "MIDI_RT_QUEUE_SIZE must be a power of 2");
+_Static_assert((MIDI_MSG_QUEUE_SIZE & (MIDI_MSG_QUEUE_SIZE - 1)) == 0,
+               "MIDI_MSG_QUEUE_SIZE must be a power of 2");
+_Static_assert(!MIDI_RX_PARSE_IN_ISR || MIDI_RX_BACKEND == MIDI_RX_BACKEND_IRQ,
+               "MIDI_RX_PARSE_IN_ISR needs MIDI_RX_BACKEND_IRQ");
+_Static_assert(MIDI_PIO_RX_PORT_COUNT >= 0 && MIDI_PIO_RX_PORT_COUNT <= 4,
+               "MIDI_PIO_RX_PORT_COUNT must be 0-4 (one PIO block)");
+
 // =============================================================================
 // Private Types
 // =============================================================================
@@ -28,33 +71,138 @@ typedef enum {
     PARSER_SYSEX,
 } parser_state_t;
 
+/**
+ * @brief One DIN MIDI input: receive ring indices, parser and counters
+ */
+typedef struct {
+    uint8_t index;                      // Port number reported in midi_message_t.port
+    
+    // Receive ring (entries in s_rx_buffer[index], stamps in s_rx_time[index])
+    volatile uint16_t rx_head;
+    volatile uint16_t rx_tail;
+    
+    // Parser state
+    parser_state_t parser_state;
+    uint8_t running_status;
+    uint8_t expected_data_bytes;
+    midi_message_t current_msg;
+    
+    // SysEx streaming: at most one USB-MIDI packet worth of bytes is held
+    uint8_t sysex_chunk[3];
+    uint8_t sysex_chunk_len;
+    bool sysex_muted;                   // Dump dropped, another port owns the stream
+    
+    // Statistics
+    volatile uint32_t rx_count;
+    volatile uint32_t message_count;
+    volatile uint32_t error_count;
+    volatile uint32_t irq_count;
+    uint16_t rx_high_water;
+    uint32_t framing_error_count;
+    uint32_t parity_error_count;
+    uint32_t break_count;
+    uint32_t overrun_error_count;
+    uint32_t sysex_drop_count;
+} midi_port_t;
+
 // =============================================================================
 // Private State
 // =============================================================================
 
-// Ring buffer for received bytes
-static volatile uint8_t s_rx_buffer[MIDI_RX_BUFFER_SIZE];
-static volatile uint16_t s_rx_head = 0;
-static volatile uint16_t s_rx_tail = 0;
+// Input ports (0 = UART, 1.. = PIO receivers)
+static midi_port_t s_ports[MIDI_PORT_COUNT];
+static uint8_t s_port_count = 1;
+
+// Receive rings of UARTDR values (data byte plus error flags), one per port
+// Aligned to the ring size so the DMA backend can use address wrapping
+static volatile uint16_t s_rx_buffer[MIDI_PORT_COUNT][MIDI_RX_BUFFER_SIZE]
+    __attribute__((aligned(MIDI_RX_BUFFER_SIZE * sizeof(uint16_t))));
+
+// Arrival timestamps (1 MHz timer), one per slot in s_rx_buffer
+static volatile uint32_t s_rx_time[MIDI_PORT_COUNT][MIDI_RX_BUFFER_SIZE];
+
+// Time one byte takes on the wire (start, 8 data and stop bits)
+#define MIDI_BYTE_TIME_US       (10u * 1000000u / MIDI_BAUD_RATE)
+
+// UARTDR error flags kept alongside each received byte
+#define RX_ERROR_BITS   (UART_UARTDR_FE_BITS | UART_UARTDR_PE_BITS | \
+                         UART_UARTDR_BE_BITS | UART_UARTDR_OE_BITS)
+
+#if MIDI_RX_BACKEND == MIDI_RX_BACKEND_DMA
+// DMA channel feeding s_rx_buffer[0]
+static int s_rx_dma_chan = -1;
+
+// Transfer count last seen, used to count bytes and detect overruns
+static uint32_t s_rx_dma_remaining = 0;
+
+// When the transfer count was last read; newer bytes arrived after this
+static uint32_t s_rx_dma_seen_us = 0;
+
+// Transfer count loaded on every (re)arm
+#define RX_DMA_TRANSFER_COUNT   0xFFFFFFFFu
+
+// Re-arm once half the transfer count is used (~8 days at full 31250 baud)
+#define RX_DMA_REARM_THRESHOLD  0x80000000u
+#endif
 
-// Parser state
-static parser_state_t s_parser_state = PARSER_IDLE;
-static uint8_t s_running_status = 0;
-static midi_message_t s_current_msg;
-static uint8_t s_expected_data_bytes = 0;
+#if MIDI_PIO_RX_PORT_COUNT > 0
+// GPIO of each PIO input, port 1 first
+static const uint8_t s_pio_rx_pins[] = MIDI_PIO_RX_PINS;
+_Static_assert(sizeof(s_pio_rx_pins) >= MIDI_PIO_RX_PORT_COUNT,
+               "MIDI_PIO_RX_PINS needs a pin for every PIO input port");
 
-// Message queue (simple single-message buffer for polling)
-static volatile bool s_message_ready = false;
-static midi_message_t s_message_queue;
+// State machine of each PIO input, and the shared program offset
+static uint s_pio_rx_sm[MIDI_PIO_RX_PORT_COUNT];
+static uint s_pio_rx_offset = 0;
+
+// PIO IRQ flag raised by the program on a framing error (4 + sm with 'rel')
+#define PIO_RX_ERROR_FLAG(sm)   (4u + (sm))
+#endif
+
+// Real-time fast lane (producer: RX ISRs, consumer: midi_uart_process)
+// The UART and PIO interrupts share a priority and cannot preempt each
+// other, so there is still only one producer at a time.
+static volatile uint8_t s_rt_bytes[MIDI_RT_QUEUE_SIZE];
+static volatile uint8_t s_rt_port[MIDI_RT_QUEUE_SIZE];
+static volatile uint32_t s_rt_time[MIDI_RT_QUEUE_SIZE];
+static volatile uint16_t s_rt_head = 0;
+static volatile uint16_t s_rt_tail = 0;
+
+// Transmit ring (producer: senders, consumer: UART TX interrupt)
+static uint8_t s_tx_buffer[MIDI_TX_BUFFER_SIZE];
+static volatile uint16_t s_tx_head = 0;
+static volatile uint16_t s_tx_tail = 0;
+
+// Running status for MIDI OUT (0 = none in effect)
+static bool s_tx_running_status_enabled = MIDI_TX_RUNNING_STATUS;
+static uint8_t s_tx_running_status = 0;
+
+// Port currently streaming SysEx to the SysEx callback (-1 = none)
+static int8_t s_sysex_owner = -1;
+
+// Parsed message queue (single producer: parser, single consumer: poller)
+static midi_message_t s_msg_queue[MIDI_MSG_QUEUE_SIZE];
+static volatile uint16_t s_msg_head = 0;
+static volatile uint16_t s_msg_tail = 0;
 
 // Callbacks
 static midi_message_callback_t s_message_callback = NULL;
 static midi_byte_callback_t s_byte_callback = NULL;
+static midi_sysex_callback_t s_sysex_callback = NULL;
+static midi_realtime_callback_t s_realtime_callback = NULL;
 
-// Statistics
-static volatile uint32_t s_rx_count = 0;
-static volatile uint32_t s_message_count = 0;
-static volatile uint32_t s_error_count = 0;
+// Statistics (per-port counters live in s_ports)
+static volatile uint16_t s_msg_high_water = 0;
+static volatile uint32_t s_msg_drop_count = 0;
+static volatile uint32_t s_rt_drop_count = 0;
+static volatile uint32_t s_rx_irq_count = 0;
+static volatile uint32_t s_tx_count = 0;
+static volatile uint32_t s_tx_drop_count = 0;
+static volatile uint32_t s_tx_saved_count = 0;
+
+// Last byte of a message received -> message queued (parse hop latency)
+static volatile uint32_t s_parse_latency_last_us = 0;
+static volatile uint32_t s_parse_latency_max_us = 0;
 
 static bool s_initialized = false;
 
@@ -63,241 +211,726 @@ static bool s_initialized = false;
 // =============================================================================
 
 /**
- * @brief Get the number of data bytes expected for a status byte
+ * @brief Push a message into the parsed message queue
+ * 
+ * Producer side of the SPSC ring. The slot is fully written before the
+ * head index is published, so the consumer never sees a partial message.
  */
-static uint8_t get_data_byte_count(uint8_t status) {
-    switch (status & 0xF0) {
-        case 0x80:  // Note Off
-        case 0x90:  // Note On
-        case 0xA0:  // Poly Pressure
-        case 0xB0:  // Control Change
-        case 0xE0:  // Pitch Bend
-            return 2;
-            
-        case 0xC0:  // Program Change
-        case 0xD0:  // Channel Pressure
-            return 1;
-            
-        case 0xF0:  // System messages
-            switch (status) {
-                case 0xF0:  // SysEx Start
-                    return 255;  // Variable length
-                case 0xF1:  // MTC Quarter Frame
-                case 0xF3:  // Song Select
-                    return 1;
-                case 0xF2:  // Song Position
-                    return 2;
-                default:    // Real-time and others
-                    return 0;
-            }
-            
-        default:
-            return 0;
+static void queue_push(const midi_message_t *msg) {
+    uint16_t head = s_msg_head;
+    uint16_t next_head = (head + 1) & (MIDI_MSG_QUEUE_SIZE - 1);
+    
+    if (next_head == s_msg_tail) {
+        // Queue full - drop the newest message
+        s_msg_drop_count++;
+        return;
+    }
+    
+    memcpy(&s_msg_queue[head], msg, sizeof(midi_message_t));
+    
+    // Make the slot contents visible before publishing the new head
+    __dmb();
+    s_msg_head = next_head;
+    
+    // Track the deepest fill level seen
+    uint16_t depth = (next_head - s_msg_tail) & (MIDI_MSG_QUEUE_SIZE - 1);
+    if (depth > s_msg_high_water) {
+        s_msg_high_water = depth;
     }
 }
 
 /**
- * @brief Get message type from status byte
+ * @brief Complete and dispatch the port's current message
+ * 
+ * @param last_byte_us Arrival time of the byte that completed the message
  */
-static midi_message_type_t get_message_type(uint8_t status) {
-    switch (status & 0xF0) {
-        case 0x80: return MIDI_MSG_NOTE_OFF;
-        case 0x90: return MIDI_MSG_NOTE_ON;
-        case 0xA0: return MIDI_MSG_POLY_PRESSURE;
-        case 0xB0: return MIDI_MSG_CONTROL_CHANGE;
-        case 0xC0: return MIDI_MSG_PROGRAM_CHANGE;
-        case 0xD0: return MIDI_MSG_CHANNEL_PRESSURE;
-        case 0xE0: return MIDI_MSG_PITCH_BEND;
-        case 0xF0:
-            switch (status) {
-                case 0xF0: return MIDI_MSG_SYSEX_START;
-                case 0xF1: return MIDI_MSG_MTC_QUARTER;
-                case 0xF2: return MIDI_MSG_SONG_POSITION;
-                case 0xF3: return MIDI_MSG_SONG_SELECT;
-                case 0xF6: return MIDI_MSG_TUNE_REQUEST;
-                case 0xF7: return MIDI_MSG_SYSEX_END;
-                case 0xF8: return MIDI_MSG_CLOCK;
-                case 0xFA: return MIDI_MSG_START;
-                case 0xFB: return MIDI_MSG_CONTINUE;
-                case 0xFC: return MIDI_MSG_STOP;
-                case 0xFE: return MIDI_MSG_ACTIVE_SENSING;
-                case 0xFF: return MIDI_MSG_SYSTEM_RESET;
-                default:   return MIDI_MSG_NONE;
-            }
-        default:
-            return MIDI_MSG_NONE;
+static void dispatch_message(midi_port_t *port, uint32_t last_byte_us) {
+    midi_message_t *msg = &port->current_msg;
+    port->message_count++;
+    msg->port = port->index;
+    
+    // Time the message spent waiting to be parsed
+    uint32_t latency = timer_hw->timerawl - last_byte_us;
+    s_parse_latency_last_us = latency;
+    if (latency > s_parse_latency_max_us) {
+        s_parse_latency_max_us = latency;
+    }
+    
+    // Handle Note On with velocity 0 as Note Off
+    if (msg->type == MIDI_MSG_NOTE_ON && msg->data2 == 0) {
+        msg->type = MIDI_MSG_NOTE_OFF;
+        msg->raw[0] = 0x80 | msg->channel;
+    }
+    
+    // Call message callback if registered
+    if (s_message_callback != NULL) {
+        s_message_callback(msg);
     }
+    
+    // Also store in queue for polling
+    queue_push(msg);
 }
 
 /**
- * @brief Check if a status byte is a real-time message
+ * @brief Deliver a real-time message through the message callback
+ * 
+ * Real-time bytes never touch parser state, so they can be delivered
+ * ahead of a message that is still being assembled.
  */
-static inline bool is_realtime_message(uint8_t byte) {
-    return byte >= 0xF8;
+static void dispatch_realtime(midi_port_t *port, uint8_t byte, uint32_t timestamp_us) {
+    midi_message_t rt_msg = {
+        .type = midi_codec_get_type(byte),
+        .channel = 0,
+        .data1 = 0,
+        .data2 = 0,
+        .raw = {byte, 0, 0},
+        .length = 1,
+        .port = port->index,
+        .timestamp_us = timestamp_us
+    };
+    
+    if (s_message_callback != NULL) {
+        s_message_callback(&rt_msg);
+    }
+    port->message_count++;
 }
 
 /**
- * @brief Complete and dispatch the current message
+ * @brief Start a SysEx dump on a port
+ * 
+ * The SysEx callback carries one stream, so a port that starts a dump
+ * while another port's dump is in progress has its dump dropped.
  */
-static void dispatch_message(void) {
-    s_message_count++;
+static void sysex_begin(midi_port_t *port) {
+    port->sysex_chunk_len = 0;
+    port->sysex_muted = (s_sysex_owner >= 0 && s_sysex_owner != port->index);
     
-    // Handle Note On with velocity 0 as Note Off
-    if (s_current_msg.type == MIDI_MSG_NOTE_ON && s_current_msg.data2 == 0) {
-        s_current_msg.type = MIDI_MSG_NOTE_OFF;
-        s_current_msg.raw[0] = 0x80 | s_current_msg.channel;
+    if (port->sysex_muted) {
+        port->sysex_drop_count++;
+    } else {
+        s_sysex_owner = (int8_t)port->index;
+    }
+}
+
+/**
+ * @brief Append a byte to the port's current SysEx chunk
+ * 
+ * Full 3-byte chunks are handed to the SysEx callback immediately, so a
+ * dump of any size streams through with constant memory.
+ */
+static void sysex_put(midi_port_t *port, uint8_t byte) {
+    if (port->sysex_muted) {
+        return;
     }
     
-    // Call message callback if registered
-    if (s_message_callback != NULL) {
-        s_message_callback(&s_current_msg);
+    port->sysex_chunk[port->sysex_chunk_len++] = byte;
+    
+    if (port->sysex_chunk_len == sizeof(port->sysex_chunk)) {
+        if (s_sysex_callback != NULL) {
+            s_sysex_callback(port->sysex_chunk, port->sysex_chunk_len, false);
+        }
+        port->sysex_chunk_len = 0;
+    }
+}
+
+/**
+ * @brief Terminate the port's current SysEx message with 0xF7
+ * 
+ * Also used when a dump is cut short by another status byte, so the
+ * receiver always sees a properly terminated message.
+ */
+static void sysex_finish(midi_port_t *port) {
+    if (port->sysex_muted) {
+        port->sysex_muted = false;
+        return;
     }
     
-    // Also store in queue for polling
-    if (!s_message_ready) {
-        memcpy((void*)&s_message_queue, &s_current_msg, sizeof(midi_message_t));
-        s_message_ready = true;
+    // sysex_put() flushes full chunks, so there is always room for 0xF7
+    port->sysex_chunk[port->sysex_chunk_len++] = 0xF7;
+    
+    if (s_sysex_callback != NULL) {
+        s_sysex_callback(port->sysex_chunk, port->sysex_chunk_len, true);
+    }
+    port->sysex_chunk_len = 0;
+    s_sysex_owner = -1;
+}
+
+/**
+ * @brief Account for a byte received with a line error and resynchronise
+ * 
+ * The byte itself is discarded. Running status and any partially
+ * assembled message are dropped, so the next valid status byte starts
+ * clean instead of the corrupted byte turning into a wrong note.
+ */
+static void handle_line_error(midi_port_t *port, uint16_t entry) {
+    if (entry & UART_UARTDR_FE_BITS) {
+        port->framing_error_count++;
+    }
+    if (entry & UART_UARTDR_PE_BITS) {
+        port->parity_error_count++;
+    }
+    if (entry & UART_UARTDR_BE_BITS) {
+        port->break_count++;
+    }
+    if (entry & UART_UARTDR_OE_BITS) {
+        port->overrun_error_count++;
+    }
+    
+    if (port->parser_state == PARSER_SYSEX) {
+        sysex_finish(port);
     }
+    port->parser_state = PARSER_IDLE;
+    port->running_status = 0;
 }
 
 /**
- * @brief Process a single MIDI byte through the parser
+ * @brief Process a single MIDI byte through a port's parser
  */
-static void parse_byte(uint8_t byte) {
+static void parse_byte(midi_port_t *port, uint8_t byte, uint32_t timestamp_us) {
+    midi_message_t *msg = &port->current_msg;
+    
     // Real-time messages can occur anywhere and don't affect running status
-    if (is_realtime_message(byte)) {
-        midi_message_t rt_msg = {
-            .type = get_message_type(byte),
-            .channel = 0,
-            .data1 = 0,
-            .data2 = 0,
-            .raw = {byte, 0, 0},
-            .length = 1
-        };
-        
-        if (s_message_callback != NULL) {
-            s_message_callback(&rt_msg);
+    // (with the IRQ backend they are taken out in the RX ISR already)
+    if (midi_codec_is_realtime(byte)) {
+        if (s_realtime_callback != NULL) {
+            s_realtime_callback(byte, timestamp_us);
         }
-        s_message_count++;
+        dispatch_realtime(port, byte, timestamp_us);
         return;
     }
     
     // Status byte (bit 7 set)
     if (byte & 0x80) {
+        // Any status byte ends a SysEx dump in progress
+        if (port->parser_state == PARSER_SYSEX) {
+            sysex_finish(port);
+            port->parser_state = PARSER_IDLE;
+            
+            if (byte == 0xF7) {
+                return;
+            }
+        }
+        
         // System common messages clear running status
         if ((byte & 0xF0) == 0xF0) {
-            s_running_status = 0;
+            port->running_status = 0;
         } else {
             // Channel message - set running status
-            s_running_status = byte;
+            port->running_status = byte;
         }
         
-        s_expected_data_bytes = get_data_byte_count(byte);
+        port->expected_data_bytes = midi_codec_get_data_length(byte);
         
         // Handle SysEx
         if (byte == 0xF0) {
-            s_parser_state = PARSER_SYSEX;
+            sysex_begin(port);
+            sysex_put(port, byte);
+            port->parser_state = PARSER_SYSEX;
             return;
         }
         
-        // Handle SysEx End
+        // Stray SysEx End
         if (byte == 0xF7) {
-            s_parser_state = PARSER_IDLE;
+            port->parser_state = PARSER_IDLE;
             return;
         }
         
         // Messages with no data bytes are complete immediately
-        if (s_expected_data_bytes == 0) {
-            s_current_msg.type = get_message_type(byte);
-            s_current_msg.channel = byte & 0x0F;
-            s_current_msg.data1 = 0;
-            s_current_msg.data2 = 0;
-            s_current_msg.raw[0] = byte;
-            s_current_msg.length = 1;
-            dispatch_message();
-            s_parser_state = PARSER_IDLE;
+        if (port->expected_data_bytes == 0) {
+            msg->type = midi_codec_get_type(byte);
+            msg->channel = byte & 0x0F;
+            msg->data1 = 0;
+            msg->data2 = 0;
+            msg->raw[0] = byte;
+            msg->length = 1;
+            msg->timestamp_us = timestamp_us;
+            dispatch_message(port, timestamp_us);
+            port->parser_state = PARSER_IDLE;
             return;
         }
         
         // Start collecting data bytes
-        s_current_msg.type = get_message_type(byte);
-        s_current_msg.channel = byte & 0x0F;
-        s_current_msg.raw[0] = byte;
-        s_current_msg.length = 1;
-        s_parser_state = PARSER_DATA1;
+        msg->type = midi_codec_get_type(byte);
+        msg->channel = byte & 0x0F;
+        msg->raw[0] = byte;
+        msg->length = 1;
+        msg->timestamp_us = timestamp_us;
+        port->parser_state = PARSER_DATA1;
         return;
     }
     
     // Data byte (bit 7 clear)
+    if (port->parser_state == PARSER_SYSEX) {
+        sysex_put(port, byte);
+        return;
+    }
+    
     // Handle running status
-    if (s_parser_state == PARSER_IDLE && s_running_status != 0) {
+    if (port->parser_state == PARSER_IDLE && port->running_status != 0) {
         // Re-use running status
-        s_expected_data_bytes = get_data_byte_count(s_running_status);
-        s_current_msg.type = get_message_type(s_running_status);
-        s_current_msg.channel = s_running_status & 0x0F;
-        s_current_msg.raw[0] = s_running_status;
-        s_current_msg.length = 1;
-        s_parser_state = PARSER_DATA1;
+        port->expected_data_bytes = midi_codec_get_data_length(port->running_status);
+        msg->type = midi_codec_get_type(port->running_status);
+        msg->channel = port->running_status & 0x0F;
+        msg->raw[0] = port->running_status;
+        msg->length = 1;
+        msg->timestamp_us = timestamp_us;
+        port->parser_state = PARSER_DATA1;
     }
     
     // Skip if we're not expecting data
-    if (s_parser_state == PARSER_IDLE || s_parser_state == PARSER_SYSEX) {
+    if (port->parser_state == PARSER_IDLE) {
         return;
     }
     
     // Collect data bytes
-    if (s_parser_state == PARSER_DATA1) {
-        s_current_msg.data1 = byte;
-        s_current_msg.raw[1] = byte;
-        s_current_msg.length = 2;
+    if (port->parser_state == PARSER_DATA1) {
+        msg->data1 = byte;
+        msg->raw[1] = byte;
+        msg->length = 2;
         
-        if (s_expected_data_bytes == 1) {
+        if (port->expected_data_bytes == 1) {
             // Message complete
-            s_current_msg.data2 = 0;
-            dispatch_message();
-            s_parser_state = PARSER_IDLE;
+            msg->data2 = 0;
+            dispatch_message(port, timestamp_us);
+            port->parser_state = PARSER_IDLE;
         } else {
-            s_parser_state = PARSER_DATA2;
+            port->parser_state = PARSER_DATA2;
         }
         return;
     }
     
-    if (s_parser_state == PARSER_DATA2) {
-        s_current_msg.data2 = byte;
-        s_current_msg.raw[2] = byte;
-        s_current_msg.length = 3;
-        dispatch_message();
-        s_parser_state = PARSER_IDLE;
+    if (port->parser_state == PARSER_DATA2) {
+        msg->data2 = byte;
+        msg->raw[2] = byte;
+        msg->length = 3;
+        dispatch_message(port, timestamp_us);
+        port->parser_state = PARSER_IDLE;
         return;
     }
 }
 
+/**
+ * @brief Reset a port's ring, parser and counters
+ */
+static void port_reset(midi_port_t *port, uint8_t index) {
+    memset(port, 0, sizeof(*port));
+    port->index = index;
+    port->parser_state = PARSER_IDLE;
+}
+
 // =============================================================================
-// UART Interrupt Handler
+// Receive Interrupt Handlers
 // =============================================================================
 
+/**
+ * @brief Take one received entry in interrupt context
+ * 
+ * Shared by the UART and PIO receive interrupts: stamps the entry, runs
+ * the real-time fast lane and appends everything else to the port's ring.
+ * With MIDI_RX_PARSE_IN_ISR the entry is parsed right here instead.
+ */
+static void rx_isr_push(midi_port_t *port, uint16_t entry, uint32_t now) {
+    uint8_t byte = (uint8_t)(entry & UART_UARTDR_DATA_BITS);
+    bool corrupted = (entry & RX_ERROR_BITS) != 0;
+    
+#if MIDI_RX_PARSE_IN_ISR
+    if (corrupted) {
+        handle_line_error(port, entry);
+        return;
+    }
+    
+    if (s_byte_callback != NULL && port->index == 0) {
+        s_byte_callback(byte);
+    }
+    
+    // Real-time bytes are dispatched by the parser without touching its state
+    parse_byte(port, byte, now);
+    return;
+#endif
+    
+    if (!corrupted) {
+        // Call raw byte callback if registered (UART input only)
+        if (s_byte_callback != NULL && port->index == 0) {
+            s_byte_callback(byte);
+        }
+        
+        // Real-time fast lane: handle now instead of waiting for the main loop
+        if (midi_codec_is_realtime(byte)) {
+            if (s_realtime_callback != NULL) {
+                s_realtime_callback(byte, now);
+            }
+            
+            uint16_t next_rt = (s_rt_head + 1) & (MIDI_RT_QUEUE_SIZE - 1);
+            if (next_rt != s_rt_tail) {
+                s_rt_bytes[s_rt_head] = byte;
+                s_rt_port[s_rt_head] = port->index;
+                s_rt_time[s_rt_head] = now;
+                s_rt_head = next_rt;
+            } else {
+                s_rt_drop_count++;
+            }
+            return;
+        }
+    }
+    
+    // Add to the port's ring buffer
+    uint16_t head = port->rx_head;
+    uint16_t next_head = (head + 1) & (MIDI_RX_BUFFER_SIZE - 1);
+    if (next_head != port->rx_tail) {
+        s_rx_buffer[port->index][head] = entry;
+        s_rx_time[port->index][head] = now;
+        port->rx_head = next_head;
+    } else {
+        // Buffer overrun
+        port->error_count++;
+    }
+}
+
+#if MIDI_RX_BACKEND == MIDI_RX_BACKEND_IRQ
+
 static void on_uart_rx(void) {
+    s_rx_irq_count++;
+    s_ports[0].irq_count++;
+    
     while (uart_is_readable(MIDI_UART_ID)) {
-        uint8_t byte = uart_getc(MIDI_UART_ID);
-        s_rx_count++;
+        // Read UARTDR directly to keep the framing/parity/break/overrun flags
+        uint16_t entry = (uint16_t)uart_get_hw(MIDI_UART_ID)->dr;
+        s_ports[0].rx_count++;
+        rx_isr_push(&s_ports[0], entry, timer_hw->timerawl);
+    }
+}
+
+#endif // MIDI_RX_BACKEND_IRQ
+
+#if MIDI_PIO_RX_PORT_COUNT > 0
+
+/**
+ * @brief Drain the RX FIFOs of all PIO input ports
+ * 
+ * A framing error flagged by the PIO program is queued ahead of the
+ * bytes drained with it, as a UARTDR-style entry with FE set, so the
+ * parser resynchronises exactly as it does for the UART input.
+ * 
+ * Each byte is stamped with its own arrival time: the newest byte in a
+ * FIFO has just arrived and each older one a byte time before it, so
+ * bytes that waited in the FIFO while other ports were drained still
+ * merge in arrival order.
+ */
+static void on_pio_rx_irq(void) {
+    PIO pio = MIDI_PIO_RX_PIO;
+    
+    for (uint8_t i = 1; i < s_port_count; i++) {
+        uint sm = s_pio_rx_sm[i - 1];
+        bool serviced = false;
         
-        // Call raw byte callback if registered
-        if (s_byte_callback != NULL) {
-            s_byte_callback(byte);
+        if (pio_interrupt_get(pio, PIO_RX_ERROR_FLAG(sm))) {
+            pio_interrupt_clear(pio, PIO_RX_ERROR_FLAG(sm));
+            uint32_t level = pio_sm_get_rx_fifo_level(pio, sm);
+            rx_isr_push(&s_ports[i], UART_UARTDR_FE_BITS,
+                        timer_hw->timerawl - level * MIDI_BYTE_TIME_US);
+            serviced = true;
         }
         
-        // Add to ring buffer
-        uint16_t next_head = (s_rx_head + 1) & (MIDI_RX_BUFFER_SIZE - 1);
-        if (next_head != s_rx_tail) {
-            s_rx_buffer[s_rx_head] = byte;
-            s_rx_head = next_head;
-        } else {
-            // Buffer overrun
-            s_error_count++;
+        while (!pio_sm_is_rx_fifo_empty(pio, sm)) {
+            uint32_t level = pio_sm_get_rx_fifo_level(pio, sm);
+            uint32_t arrival = timer_hw->timerawl - (level - 1) * MIDI_BYTE_TIME_US;
+            s_ports[i].rx_count++;
+            rx_isr_push(&s_ports[i], midi_uart_rx_program_get(pio, sm), arrival);
+            serviced = true;
         }
+        
+        if (serviced) {
+            s_ports[i].irq_count++;
+        }
+    }
+}
+
+#endif // MIDI_PIO_RX_PORT_COUNT > 0
+
+/**
+ * @brief Move bytes from the TX ring into the UART TX FIFO
+ * 
+ * Runs from the UART interrupt, and from senders (with interrupts
+ * disabled) to prime an idle transmitter. The TX interrupt is disabled
+ * once the ring is empty so it does not fire with nothing to send.
+ */
+static void tx_pump(void) {
+    uart_hw_t *hw = uart_get_hw(MIDI_UART_ID);
+    
+    while (s_tx_tail != s_tx_head && uart_is_writable(MIDI_UART_ID)) {
+        hw->dr = s_tx_buffer[s_tx_tail];
+        s_tx_tail = (s_tx_tail + 1) & (MIDI_TX_BUFFER_SIZE - 1);
+        s_tx_count++;
+    }
+    
+    if (s_tx_tail == s_tx_head) {
+        hw_clear_bits(&hw->imsc, UART_UARTIMSC_TXIM_BITS);
+    } else {
+        hw_set_bits(&hw->imsc, UART_UARTIMSC_TXIM_BITS);
     }
 }
 
+static void on_uart_irq(void) {
+#if MIDI_RX_BACKEND == MIDI_RX_BACKEND_IRQ
+    if (uart_get_hw(MIDI_UART_ID)->mis & (UART_UARTMIS_RXMIS_BITS | UART_UARTMIS_RTMIS_BITS)) {
+        on_uart_rx();
+    }
+#endif
+    
+    tx_pump();
+}
+
+// =============================================================================
+// UART DMA Receiver
+// =============================================================================
+
+#if MIDI_RX_BACKEND == MIDI_RX_BACKEND_DMA
+
+/**
+ * @brief Claim and start the RX DMA channel
+ * 
+ * The channel reads UARTDR paced by the UART RX DREQ and writes into
+ * port 0's ring with the write address wrapping at the end of the ring.
+ * Transfers are 16 bits wide so the line error flags come along with
+ * each data byte.
+ */
+static bool rx_dma_start(void) {
+    s_rx_dma_chan = dma_claim_unused_channel(false);
+    if (s_rx_dma_chan < 0) {
+        DEBUG_PRINT("MIDI UART: Failed to claim RX DMA channel\n");
+        return false;
+    }
+    
+    dma_channel_config c = dma_channel_get_default_config(s_rx_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, __builtin_ctz(sizeof(s_rx_buffer[0])));
+    channel_config_set_dreq(&c, uart_get_dreq(MIDI_UART_ID, false));
+    
+    dma_channel_configure(
+        s_rx_dma_chan,
+        &c,
+        s_rx_buffer[0],                         // Write into the ring
+        &uart_get_hw(MIDI_UART_ID)->dr,         // Read from UART data register
+        RX_DMA_TRANSFER_COUNT,
+        true                                    // Start immediately
+    );
+    s_rx_dma_remaining = RX_DMA_TRANSFER_COUNT;
+    s_rx_dma_seen_us = timer_hw->timerawl;
+    
+    // Let the UART raise RX DMA requests
+    hw_set_bits(&uart_get_hw(MIDI_UART_ID)->dmacr, UART_UARTDMACR_RXDMAE_BITS);
+    
+    return true;
+}
+
+/**
+ * @brief Stop and release the RX DMA channel
+ */
+static void rx_dma_stop(void) {
+    if (s_rx_dma_chan < 0) {
+        return;
+    }
+    
+    hw_clear_bits(&uart_get_hw(MIDI_UART_ID)->dmacr, UART_UARTDMACR_RXDMAE_BITS);
+    dma_channel_abort(s_rx_dma_chan);
+    dma_channel_unclaim(s_rx_dma_chan);
+    s_rx_dma_chan = -1;
+}
+
+/**
+ * @brief Update port 0's ring head from the DMA write address
+ * 
+ * The DMA engine never looks at the ring tail, so an overrun shows up as
+ * more bytes received since the last update than there was free space. In
+ * that case the unread data is unreliable and is discarded.
+ */
+static void rx_dma_update_head(void) {
+    midi_port_t *port = &s_ports[0];
+    dma_channel_hw_t *hw = dma_channel_hw_addr(s_rx_dma_chan);
+    
+    // Read the count first: the head can only be ahead of it, never behind
+    uint32_t remaining = hw->transfer_count;
+    uint16_t head = (uint16_t)((hw->write_addr - (uintptr_t)s_rx_buffer[0]) / sizeof(s_rx_buffer[0][0]))
+                    & (MIDI_RX_BUFFER_SIZE - 1);
+    
+    uint32_t now = timer_hw->timerawl;
+    uint32_t seen_us = s_rx_dma_seen_us;
+    s_rx_dma_seen_us = now;
+    
+    uint32_t received = s_rx_dma_remaining - remaining;
+    s_rx_dma_remaining = remaining;
+    port->rx_count += received;
+    
+    uint16_t unread = (port->rx_head - port->rx_tail) & (MIDI_RX_BUFFER_SIZE - 1);
+    if (received >= (uint32_t)(MIDI_RX_BUFFER_SIZE - unread)) {
+        // Buffer overrun
+        port->error_count++;
+        port->rx_tail = head;
+        port->rx_head = head;
+        return;
+    }
+    
+    // The DMA leaves no per-byte timing, so estimate it from the count of
+    // new bytes: the last one has just arrived and each earlier one a byte
+    // time before it, but none before the previous update
+    uint32_t age_us = (received - 1) * MIDI_BYTE_TIME_US;
+    for (uint16_t i = port->rx_head; i != head; i = (i + 1) & (MIDI_RX_BUFFER_SIZE - 1)) {
+        uint32_t arrival = now - age_us;
+        if ((int32_t)(arrival - seen_us) < 0) {
+            arrival = seen_us;
+        }
+        s_rx_time[0][i] = arrival;
+        age_us -= MIDI_BYTE_TIME_US;
+    }
+    
+    port->rx_head = head;
+}
+
+/**
+ * @brief Reload the transfer count before it runs out
+ * 
+ * Bytes arriving while the channel is stopped wait in the 32-byte UART
+ * FIFO, and the channel resumes from its current write address.
+ */
+static void rx_dma_rearm_if_needed(void) {
+    if (dma_channel_hw_addr(s_rx_dma_chan)->transfer_count >= RX_DMA_REARM_THRESHOLD) {
+        return;
+    }
+    
+    dma_channel_abort(s_rx_dma_chan);
+    rx_dma_update_head();
+    
+    dma_channel_set_trans_count(s_rx_dma_chan, RX_DMA_TRANSFER_COUNT, true);
+    s_rx_dma_remaining = RX_DMA_TRANSFER_COUNT;
+}
+
+#endif // MIDI_RX_BACKEND_DMA
+
+// =============================================================================
+// PIO Receivers
+// =============================================================================
+
+#if MIDI_PIO_RX_PORT_COUNT > 0
+
+/**
+ * @brief Release the state machines and program of the PIO input ports
+ */
+static void pio_rx_stop(void) {
+    PIO pio = MIDI_PIO_RX_PIO;
+    
+    if (s_port_count <= 1) {
+        return;
+    }
+    
+    uint irq_num = pio_get_irq_num(pio, 0);
+    for (uint8_t i = 1; i < s_port_count; i++) {
+        uint sm = s_pio_rx_sm[i - 1];
+        pio_set_irqn_source_enabled(pio, 0, pis_sm0_rx_fifo_not_empty + sm, false);
+        pio_sm_set_enabled(pio, sm, false);
+        pio_sm_unclaim(pio, sm);
+    }
+    irq_remove_handler(irq_num, on_pio_rx_irq);
+    pio_remove_program(pio, &midi_uart_rx_program, s_pio_rx_offset);
+    
+    s_port_count = 1;
+}
+
+/**
+ * @brief Start a PIO UART receiver for each extra input port
+ * 
+ * Ports whose state machine cannot be claimed are left out; the UART
+ * input keeps working either way.
+ */
+static void pio_rx_start(void) {
+    PIO pio = MIDI_PIO_RX_PIO;
+    
+    if (!pio_can_add_program(pio, &midi_uart_rx_program)) {
+        DEBUG_PRINT("MIDI UART: No PIO program space for extra inputs\n");
+        return;
+    }
+    s_pio_rx_offset = pio_add_program(pio, &midi_uart_rx_program);
+    
+    for (uint8_t i = 0; i < MIDI_PIO_RX_PORT_COUNT; i++) {
+        int sm = pio_claim_unused_sm(pio, false);
+        if (sm < 0) {
+            DEBUG_PRINT("MIDI UART: No PIO state machine for input %d\n", i + 1);
+            break;
+        }
+        
+        s_pio_rx_sm[i] = (uint)sm;
+        pio_interrupt_clear(pio, PIO_RX_ERROR_FLAG(sm));
+        midi_uart_rx_program_init(pio, sm, s_pio_rx_offset, s_pio_rx_pins[i], MIDI_BAUD_RATE);
+        pio_set_irqn_source_enabled(pio, 0, pis_sm0_rx_fifo_not_empty + sm, true);
+        s_port_count++;
+    }
+    
+    if (s_port_count == 1) {
+        pio_remove_program(pio, &midi_uart_rx_program, s_pio_rx_offset);
+        return;
+    }
+    
+    // Shared, since the GB link may use the same PIO block's interrupts
+    uint irq_num = pio_get_irq_num(pio, 0);
+    irq_add_shared_handler(irq_num, on_pio_rx_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(irq_num, true);
+}
+
+#endif // MIDI_PIO_RX_PORT_COUNT > 0
+
+// =============================================================================
+// MIDI Output
+// =============================================================================
+
+/**
+ * @brief Queue one message worth of bytes for transmission
+ * 
+ * Applies running status to the leading status byte. The message is
+ * queued whole or not at all.
+ */
+static bool tx_enqueue(const uint8_t *bytes, uint8_t length) {
+    uint8_t status = bytes[0];
+    uint8_t skip = 0;
+    
+    if (status >= 0xF8) {
+        // Real-time bytes do not affect running status
+    } else if (status >= 0xF0) {
+        // System common cancels running status
+        s_tx_running_status = 0;
+    } else if (status & 0x80) {
+        if (s_tx_running_status_enabled && status == s_tx_running_status) {
+            skip = 1;
+        }
+        s_tx_running_status = status;
+    }
+    
+    uint16_t used = (s_tx_head - s_tx_tail) & (MIDI_TX_BUFFER_SIZE - 1);
+    uint16_t free_space = (MIDI_TX_BUFFER_SIZE - 1) - used;
+    if ((uint16_t)(length - skip) > free_space) {
+        // Receiver must see the next status byte after a gap in the stream
+        s_tx_running_status = 0;
+        s_tx_drop_count++;
+        return false;
+    }
+    
+    uint16_t head = s_tx_head;
+    for (uint8_t i = skip; i < length; i++) {
+        s_tx_buffer[head] = bytes[i];
+        head = (head + 1) & (MIDI_TX_BUFFER_SIZE - 1);
+    }
+    s_tx_saved_count += skip;
+    
+    // Publish the bytes, then make sure the transmitter is running
+    __dmb();
+    uint32_t irq_state = save_and_disable_interrupts();
+    s_tx_head = head;
+    tx_pump();
+    restore_interrupts(irq_state);
+    
+    return true;
+}
+
 // =============================================================================
 // Public Functions
 // =============================================================================
@@ -323,27 +956,56 @@ bool midi_uart_init(void) {
     // Enable FIFO
     uart_set_fifo_enabled(MIDI_UART_ID, true);
     
-    // Set up interrupt handler
+    // Reset state
+    for (uint8_t i = 0; i < MIDI_PORT_COUNT; i++) {
+        port_reset(&s_ports[i], i);
+    }
+    s_port_count = 1;
+    s_sysex_owner = -1;
+    s_rt_head = 0;
+    s_rt_tail = 0;
+    s_msg_head = 0;
+    s_msg_tail = 0;
+    s_msg_high_water = 0;
+    s_msg_drop_count = 0;
+    s_rt_drop_count = 0;
+    s_rx_irq_count = 0;
+    s_tx_head = 0;
+    s_tx_tail = 0;
+    s_tx_running_status = 0;
+    s_tx_count = 0;
+    s_tx_drop_count = 0;
+    s_tx_saved_count = 0;
+    s_parse_latency_last_us = 0;
+    s_parse_latency_max_us = 0;
+    
+#if MIDI_RX_BACKEND == MIDI_RX_BACKEND_DMA
+    // DMA drains the RX FIFO - no RX interrupts needed
+    if (!rx_dma_start()) {
+        uart_deinit(MIDI_UART_ID);
+        return false;
+    }
+#endif
+    
+    // Set up interrupt handler (TX, plus RX with the IRQ backend)
     int uart_irq = (MIDI_UART_ID == uart0) ? UART0_IRQ : UART1_IRQ;
-    irq_set_exclusive_handler(uart_irq, on_uart_rx);
+    irq_set_exclusive_handler(uart_irq, on_uart_irq);
     irq_set_enabled(uart_irq, true);
     
-    // Enable RX interrupt
-    uart_set_irq_enables(MIDI_UART_ID, true, false);
+    // Enable RX interrupt; TX interrupt is enabled on demand by tx_pump()
+    uart_set_irq_enables(MIDI_UART_ID, MIDI_RX_BACKEND == MIDI_RX_BACKEND_IRQ, false);
     
-    // Reset state
-    s_rx_head = 0;
-    s_rx_tail = 0;
-    s_parser_state = PARSER_IDLE;
-    s_running_status = 0;
-    s_message_ready = false;
-    s_rx_count = 0;
-    s_message_count = 0;
-    s_error_count = 0;
+#if MIDI_PIO_RX_PORT_COUNT > 0
+    // Extra inputs on PIO
+    pio_rx_start();
+#endif
     
     s_initialized = true;
     
-    DEBUG_PRINT("MIDI UART: Initialized at %d baud\n", MIDI_BAUD_RATE);
+    DEBUG_PRINT("MIDI UART: Initialized at %d baud (%s RX, parse in %s, %d input%s)\n", MIDI_BAUD_RATE,
+                (MIDI_RX_BACKEND == MIDI_RX_BACKEND_DMA) ? "DMA" : "IRQ",
+                MIDI_RX_PARSE_IN_ISR ? "ISR" : "main loop",
+                s_port_count, (s_port_count == 1) ? "" : "s");
     
     return true;
 }
@@ -353,8 +1015,17 @@ void midi_uart_deinit(void) {
         return;
     }
     
+#if MIDI_PIO_RX_PORT_COUNT > 0
+    pio_rx_stop();
+#endif
+    
+#if MIDI_RX_BACKEND == MIDI_RX_BACKEND_DMA
+    rx_dma_stop();
+#endif
+    
     // Disable interrupt
     int uart_irq = (MIDI_UART_ID == uart0) ? UART0_IRQ : UART1_IRQ;
+    uart_set_irq_enables(MIDI_UART_ID, false, false);
     irq_set_enabled(uart_irq, false);
     
     // Deinitialize UART
@@ -373,46 +1044,288 @@ void midi_uart_set_byte_callback(midi_byte_callback_t callback) {
     s_byte_callback = callback;
 }
 
+void midi_uart_set_sysex_callback(midi_sysex_callback_t callback) {
+    s_sysex_callback = callback;
+}
+
+void midi_uart_set_realtime_callback(midi_realtime_callback_t callback) {
+    s_realtime_callback = callback;
+}
+
 bool midi_uart_message_available(void) {
-    return s_message_ready;
+    return s_msg_tail != s_msg_head;
 }
 
 bool midi_uart_get_message(midi_message_t *msg) {
-    if (!s_message_ready || msg == NULL) {
+    if (msg == NULL) {
+        return false;
+    }
+    
+    uint16_t tail = s_msg_tail;
+    if (tail == s_msg_head) {
         return false;
     }
     
-    // Copy message and clear ready flag
-    memcpy(msg, (void*)&s_message_queue, sizeof(midi_message_t));
-    s_message_ready = false;
+    // Observe the published head before reading the slot it covers
+    __dmb();
+    memcpy(msg, &s_msg_queue[tail], sizeof(midi_message_t));
+    
+    // Finish reading the slot before handing it back to the producer
+    __dmb();
+    s_msg_tail = (tail + 1) & (MIDI_MSG_QUEUE_SIZE - 1);
     
     return true;
 }
 
 void midi_uart_process(void) {
-    // Process all bytes in the ring buffer
-    while (s_rx_tail != s_rx_head) {
-        uint8_t byte = s_rx_buffer[s_rx_tail];
-        s_rx_tail = (s_rx_tail + 1) & (MIDI_RX_BUFFER_SIZE - 1);
+    if (!s_initialized) {
+        return;
+    }
+    
+#if MIDI_RX_BACKEND == MIDI_RX_BACKEND_DMA
+    rx_dma_rearm_if_needed();
+    rx_dma_update_head();
+#endif
+    
+    // Real-time bytes already pulled out by the ISR go first
+    while (s_rt_tail != s_rt_head) {
+        uint8_t byte = s_rt_bytes[s_rt_tail];
+        uint8_t port = s_rt_port[s_rt_tail];
+        uint32_t timestamp_us = s_rt_time[s_rt_tail];
+        s_rt_tail = (s_rt_tail + 1) & (MIDI_RT_QUEUE_SIZE - 1);
         
-        parse_byte(byte);
+        dispatch_realtime(&s_ports[port], byte, timestamp_us);
+    }
+    
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        midi_port_t *port = &s_ports[i];
+        uint16_t fill = (port->rx_head - port->rx_tail) & (MIDI_RX_BUFFER_SIZE - 1);
+        if (fill > port->rx_high_water) {
+            port->rx_high_water = fill;
+        }
     }
+    
+    // Merge the port rings: always parse the oldest pending byte next.
+    // With the DMA backend port 0's stamps are estimates made when the
+    // bytes are first seen here (see rx_dma_update_head()), so against the
+    // PIO ports its order is only exact to within a byte time or so.
+    for (;;) {
+        midi_port_t *port = NULL;
+        uint32_t timestamp_us = 0;
+        
+        for (uint8_t i = 0; i < s_port_count; i++) {
+            midi_port_t *candidate = &s_ports[i];
+            if (candidate->rx_tail == candidate->rx_head) {
+                continue;
+            }
+            
+            // Wrap-safe comparison of 1 MHz timer stamps
+            uint32_t t = s_rx_time[i][candidate->rx_tail];
+            if (port == NULL || (int32_t)(t - timestamp_us) < 0) {
+                port = candidate;
+                timestamp_us = t;
+            }
+        }
+        
+        if (port == NULL) {
+            break;
+        }
+        
+        uint16_t entry = s_rx_buffer[port->index][port->rx_tail];
+        port->rx_tail = (port->rx_tail + 1) & (MIDI_RX_BUFFER_SIZE - 1);
+        
+        if (entry & RX_ERROR_BITS) {
+            handle_line_error(port, entry);
+            continue;
+        }
+        uint8_t byte = (uint8_t)entry;
+        
+#if MIDI_RX_BACKEND == MIDI_RX_BACKEND_DMA
+        // No ISR sees the UART bytes in DMA mode, so run the byte callback here
+        if (s_byte_callback != NULL && port->index == 0) {
+            s_byte_callback(byte);
+        }
+#endif
+        
+        parse_byte(port, byte, timestamp_us);
+    }
+}
+
+bool midi_uart_send_message(const midi_message_t *msg) {
+    if (!s_initialized || msg == NULL || msg->length == 0 || msg->length > 3) {
+        return false;
+    }
+    
+    return tx_enqueue(msg->raw, msg->length);
+}
+
+bool midi_uart_send_raw(const uint8_t *bytes, uint8_t length) {
+    if (!s_initialized || bytes == NULL || length == 0) {
+        return false;
+    }
+    
+    return tx_enqueue(bytes, length);
+}
+
+void midi_uart_set_tx_running_status(bool enabled) {
+    s_tx_running_status_enabled = enabled;
+    
+    // Force the next message to carry its status byte
+    s_tx_running_status = 0;
+}
+
+uint16_t midi_uart_tx_free(void) {
+    uint16_t used = (s_tx_head - s_tx_tail) & (MIDI_TX_BUFFER_SIZE - 1);
+    return (MIDI_TX_BUFFER_SIZE - 1) - used;
+}
+
+uint8_t midi_uart_get_port_count(void) {
+    return s_port_count;
+}
+
+bool midi_uart_get_port_stats(uint8_t port, midi_uart_port_stats_t *stats) {
+    if (port >= s_port_count || stats == NULL) {
+        return false;
+    }
+    
+    const midi_port_t *p = &s_ports[port];
+    stats->rx_count = p->rx_count;
+    stats->message_count = p->message_count;
+    stats->error_count = p->error_count;
+    stats->irq_count = p->irq_count;
+    stats->rx_high_water = p->rx_high_water;
+    stats->framing_error_count = p->framing_error_count;
+    stats->parity_error_count = p->parity_error_count;
+    stats->break_count = p->break_count;
+    stats->overrun_error_count = p->overrun_error_count;
+    stats->sysex_drop_count = p->sysex_drop_count;
+    
+    return true;
 }
 
 uint32_t midi_uart_get_rx_count(void) {
-    return s_rx_count;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        total += s_ports[i].rx_count;
+    }
+    return total;
 }
 
 uint32_t midi_uart_get_message_count(void) {
-    return s_message_count;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        total += s_ports[i].message_count;
+    }
+    return total;
 }
 
 uint32_t midi_uart_get_error_count(void) {
-    return s_error_count;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        total += s_ports[i].error_count;
+    }
+    return total;
+}
+
+uint16_t midi_uart_get_queue_high_water(void) {
+    return s_msg_high_water;
+}
+
+uint32_t midi_uart_get_queue_drop_count(void) {
+    return s_msg_drop_count;
+}
+
+uint32_t midi_uart_get_rt_drop_count(void) {
+    return s_rt_drop_count;
+}
+
+uint32_t midi_uart_get_rx_irq_count(void) {
+    return s_rx_irq_count;
+}
+
+uint16_t midi_uart_get_rx_high_water(void) {
+    uint16_t high_water = 0;
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        if (s_ports[i].rx_high_water > high_water) {
+            high_water = s_ports[i].rx_high_water;
+        }
+    }
+    return high_water;
+}
+
+uint32_t midi_uart_get_framing_error_count(void) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        total += s_ports[i].framing_error_count;
+    }
+    return total;
+}
+
+uint32_t midi_uart_get_parity_error_count(void) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        total += s_ports[i].parity_error_count;
+    }
+    return total;
+}
+
+uint32_t midi_uart_get_break_count(void) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        total += s_ports[i].break_count;
+    }
+    return total;
+}
+
+uint32_t midi_uart_get_overrun_error_count(void) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < s_port_count; i++) {
+        total += s_ports[i].overrun_error_count;
+    }
+    return total;
+}
+
+uint32_t midi_uart_get_parse_latency_last_us(void) {
+    return s_parse_latency_last_us;
+}
+
+uint32_t midi_uart_get_parse_latency_max_us(void) {
+    return s_parse_latency_max_us;
+}
+
+uint32_t midi_uart_get_tx_count(void) {
+    return s_tx_count;
+}
+
+uint32_t midi_uart_get_tx_drop_count(void) {
+    return s_tx_drop_count;
+}
+
+uint32_t midi_uart_get_tx_saved_count(void) {
+    return s_tx_saved_count;
 }
 
 void midi_uart_reset_stats(void) {
-    s_rx_count = 0;
-    s_message_count = 0;
-    s_error_count = 0;
+    for (uint8_t i = 0; i < MIDI_PORT_COUNT; i++) {
+        midi_port_t *port = &s_ports[i];
+        port->rx_count = 0;
+        port->message_count = 0;
+        port->error_count = 0;
+        port->irq_count = 0;
+        port->rx_high_water = 0;
+        port->framing_error_count = 0;
+        port->parity_error_count = 0;
+        port->break_count = 0;
+        port->overrun_error_count = 0;
+        port->sysex_drop_count = 0;
+    }
+    s_msg_high_water = 0;
+    s_msg_drop_count = 0;
+    s_rt_drop_count = 0;
+    s_rx_irq_count = 0;
+    s_tx_count = 0;
+    s_tx_drop_count = 0;
+    s_tx_saved_count = 0;
+    s_parse_latency_last_us = 0;
+    s_parse_latency_max_us = 0;
 }
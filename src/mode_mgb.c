@@ -3,25 +3,78 @@
  * @brief mGB MIDI IN mode handler implementation
  * 
  * Receives MIDI from DIN/TRS input and USB, forwards to Game Boy running mGB.
- * Also forwards DIN MIDI to USB (MIDI thru/merge).
+ * Also forwards DIN MIDI to USB and USB MIDI to DIN MIDI OUT (thru/merge).
  * 
  * mGB expects raw MIDI bytes with channel remapping:
  * - External MIDI channels are mapped to mGB's internal channels (0-4)
- * - A delay between bytes is required for mGB to process them
+ * - A delay between bytes is required for mGB to process them; the GB link
+ *   PIO program enforces it (mode_mgb_config_t.byte_gap_us)
+ * 
+ * DIN and USB messages for the Game Boys wait in a queue per source and
+ * are merged round-robin, one message from each source in turn, whenever
+ * every output queue has room. When the link is saturated each source
+ * gets an equal share and only the one sending more than its share
+ * overflows its own queue.
+ * 
+ * Messages for the Game Boys go into a per-port output queue. A hardware
+ * alarm moves them into the GB link TX ring one at a time, each once the
+ * previous one has left the ring and FIFO, so the main loop never waits
+ * for the link; a full output queue drops the message. Keeping the ring
+ * this shallow means the priority and coalescing decisions below are
+ * made just before each message goes on the wire, not 64 bytes ahead.
+ * 
+ * Each port has an output queue per priority class: notes go out first,
+ * then program changes, then controllers. A message that has waited
+ * MGB_STARVATION_BOUND_US goes next regardless of class, so a stream of
+ * notes cannot hold back controllers forever.
+ * 
+ * Ports whose target parses it can use running status: the status byte
+ * is left out when it repeats the previous message's, and sent again
+ * after running_status_refresh messages or a quiet link so the target
+ * can resync. This is applied as messages go to the link, after priority
+ * ordering, so it always matches the byte order on the wire.
+ * 
+ * DIN traffic for the USB host (thru/merge) is queued by the midi_uart
+ * callbacks and sent from mode_mgb_process(), so TinyUSB is only ever
+ * written from the main loop even when MIDI_RX_PARSE_IN_ISR runs the
+ * callbacks in the RX interrupts.
+ * 
+ * MIDI real-time bytes can be forwarded too (forward_realtime). They are
+ * queued straight from the midi_uart real-time callback, which runs in
+ * the RX interrupt, and the release alarm is fired at once; they go out
+ * ahead of every class, between messages.
+ * 
+ * Continuous controllers are coalesced in the output queue: a control
+ * change, pitch bend or pressure update replaces a queued, unsent one for
+ * the same channel (and controller or note) in place, so sweeps faster
+ * than the link only ever send the latest value. Notes, program changes
+ * and everything else keep strict order.
  */
 
 #include "mode_mgb.h"
 #include "config.h"
 #include "gb_link.h"
 #include "midi_uart.h"
+#include "midi_codec.h"
 #include "usb_midi.h"
 #include "led.h"
 
+#include "hardware/timer.h"
+#include "hardware/sync.h"
 #include "pico/stdlib.h"
 #include "pico/time.h"
 
 #include <string.h>
 
+_Static_assert((MGB_OUT_QUEUE_SIZE & (MGB_OUT_QUEUE_SIZE - 1)) == 0,
+               "MGB_OUT_QUEUE_SIZE must be a power of 2");
+_Static_assert((MGB_SOURCE_QUEUE_SIZE & (MGB_SOURCE_QUEUE_SIZE - 1)) == 0,
+               "MGB_SOURCE_QUEUE_SIZE must be a power of 2");
+_Static_assert((MGB_RT_QUEUE_SIZE & (MGB_RT_QUEUE_SIZE - 1)) == 0,
+               "MGB_RT_QUEUE_SIZE must be a power of 2");
+_Static_assert((MGB_USB_THRU_QUEUE_SIZE & (MGB_USB_THRU_QUEUE_SIZE - 1)) == 0,
+               "MGB_USB_THRU_QUEUE_SIZE must be a power of 2");
+
 // =============================================================================
 // Private State
 // =============================================================================
@@ -32,121 +85,930 @@ static bool s_active = false;
 // Statistics
 static volatile uint32_t s_forward_count = 0;
 static volatile uint32_t s_drop_count = 0;
+static uint32_t s_coalesced_count = 0;
+static uint32_t s_stale_update_count = 0;
+static uint32_t s_source_forward_count[MGB_SOURCE_COUNT];
+static uint32_t s_source_drop_count[MGB_SOURCE_COUNT];
+
+// Messages waiting to be merged, per source (main loop only)
+static midi_message_t s_source_queue[MGB_SOURCE_COUNT][MGB_SOURCE_QUEUE_SIZE];
+static uint16_t s_source_head[MGB_SOURCE_COUNT];
+static uint16_t s_source_tail[MGB_SOURCE_COUNT];
+
+// Source the merge tries first next time
+static uint8_t s_merge_next = 0;
+
+/**
+ * @brief DIN traffic waiting to be sent to the USB host
+ */
+typedef struct {
+    midi_message_t msg;         // Message, or SysEx chunk in raw/length
+    bool sysex;                 // raw holds a SysEx chunk
+    bool end;                   // The chunk terminates the SysEx
+} mgb_thru_entry_t;
+
+// DIN to USB thru queue (producer: midi_uart callbacks, possibly in the RX
+// interrupts; consumer: main loop)
+static mgb_thru_entry_t s_thru_queue[MGB_USB_THRU_QUEUE_SIZE];
+static volatile uint16_t s_thru_head = 0;
+static volatile uint16_t s_thru_tail = 0;
+
+// Input-to-link latency: first MIDI byte arrival to message handed to the
+// GB link TX ring (written by the release alarm)
+static volatile uint32_t s_latency_last_us = 0;
+static volatile uint32_t s_latency_max_us = 0;
+
+/**
+ * @brief A remapped message waiting for room in the GB link TX ring
+ */
+typedef struct {
+    uint8_t bytes[3];
+    uint8_t length;
+    uint32_t queued_us;         // Time it entered the output queue
+    uint32_t input_us;          // Arrival of its first MIDI byte
+} mgb_out_message_t;
+
+// Output queues per port and priority class
+// (producer: main loop, consumer: release alarm)
+static mgb_out_message_t s_out_queue[GB_LINK_PORT_COUNT][MGB_CLASS_COUNT][MGB_OUT_QUEUE_SIZE];
+static volatile uint16_t s_out_head[GB_LINK_PORT_COUNT][MGB_CLASS_COUNT];
+static volatile uint16_t s_out_tail[GB_LINK_PORT_COUNT][MGB_CLASS_COUNT];
+
+// Real-time bytes per port, sent ahead of the output queues
+// (producers: real-time callback and USB input, consumer: release alarm)
+static uint8_t s_rt_queue[GB_LINK_PORT_COUNT][MGB_RT_QUEUE_SIZE];
+static volatile uint8_t s_rt_head[GB_LINK_PORT_COUNT];
+static volatile uint8_t s_rt_tail[GB_LINK_PORT_COUNT];
+
+// Running status encoder per port (release alarm only): last status byte
+// sent (0 = none in effect), messages since it was last sent, and the
+// time of the last message
+static uint8_t s_rs_status[GB_LINK_PORT_COUNT];
+static uint8_t s_rs_omitted[GB_LINK_PORT_COUNT];
+static uint32_t s_rs_last_us[GB_LINK_PORT_COUNT];
+static uint32_t s_rs_saved_count = 0;
+
+// Output queueing delay per class, queued to handed to the link
+static uint32_t s_delay_count[MGB_CLASS_COUNT];
+static uint64_t s_delay_total_us[MGB_CLASS_COUNT];
+static uint32_t s_delay_last_us[MGB_CLASS_COUNT];
+static uint32_t s_delay_max_us[MGB_CLASS_COUNT];
+
+// Hardware alarm releasing the output queues, and whether it is due to run
+static int s_release_alarm = -1;
+static volatile bool s_release_pending = false;
 
-// Timing for inter-byte delay
-static absolute_time_t s_last_byte_time;
+// SysEx from USB being matched against the trace request (F0 excluded),
+// SYSEX_IDLE when not inside a SysEx
+#define SYSEX_IDLE  0xFF
+static uint8_t s_usb_sysex[3];
+static uint8_t s_usb_sysex_len = SYSEX_IDLE;
+
+// Trace dump being streamed (main loop only): header bytes, length of the
+// whole SysEx and bytes sent so far (done when s_dump_pos == s_dump_len)
+#define DUMP_HEADER_BYTES   6
+#define DUMP_ENTRY_BYTES    12
+static uint8_t s_dump_header[DUMP_HEADER_BYTES];
+static uint32_t s_dump_len = 0;
+static uint32_t s_dump_pos = 0;
+
+// DIN SysEx partly sent to USB; a dump must not start inside it
+static bool s_thru_in_sysex = false;
+
+#if GB_LINK_TRACE
+// Copy of the trace being dumped
+static gb_link_trace_entry_t s_trace_copy[GB_LINK_TRACE_SIZE];
+#endif
 
 // =============================================================================
 // Default Configuration
 // =============================================================================
 
 static void apply_default_config(void) {
-    // Default mapping: MIDI channels 1-5 → mGB channels 0-4
+    // Default mapping on every port: MIDI channels 1-5 → mGB channels 0-4
     // MIDI channels 6-16 are not mapped (disabled)
-    for (int i = 0; i < 16; i++) {
-        if (i < MGB_CHANNEL_COUNT) {
-            s_config.midi_to_mgb_channel[i] = i;
-        } else {
-            s_config.midi_to_mgb_channel[i] = 0xFF;  // Disabled
+    for (int port = 0; port < GB_LINK_PORT_COUNT; port++) {
+        for (int i = 0; i < 16; i++) {
+            if (i < MGB_CHANNEL_COUNT) {
+                s_config.midi_to_mgb_channel[port][i] = i;
+            } else {
+                s_config.midi_to_mgb_channel[port][i] = 0xFF;  // Disabled
+            }
         }
     }
     
+    // Every Game Boy plays the same parts until per-port routing is chosen
+    s_config.routing = MGB_ROUTING_BROADCAST;
+    
     // Enable all mGB channels by default
     for (int i = 0; i < MGB_CHANNEL_COUNT; i++) {
         s_config.channel_enabled[i] = true;
     }
+    
+    s_config.byte_gap_us = MGB_INTER_BYTE_DELAY_US;
+    s_config.link_profile = GB_LINK_PROFILE_DMG_MGB;
+    
+    for (int port = 0; port < GB_LINK_PORT_COUNT; port++) {
+        s_config.running_status[port] = MGB_RUNNING_STATUS;
+    }
+    s_config.running_status_refresh = MGB_RUNNING_STATUS_REFRESH;
+    
+    for (int port = 0; port < GB_LINK_PORT_COUNT; port++) {
+        s_config.forward_realtime[port] = MGB_FORWARD_REALTIME;
+    }
+}
+
+/**
+ * @brief Apply the link clock and byte pacing from the configuration
+ */
+static void apply_link_config(void) {
+    for (uint8_t port = 0; port < gb_link_get_port_count(); port++) {
+        gb_link_select_profile(port, s_config.link_profile);
+        gb_link_set_byte_gap_us(port, s_config.byte_gap_us);
+    }
+    
+    // Force the next message on every port to carry its status byte
+    uint32_t irq_state = save_and_disable_interrupts();
+    memset(s_rs_status, 0, sizeof(s_rs_status));
+    restore_interrupts(irq_state);
 }
 
 // =============================================================================
-// MIDI Message Handling
+// Output Scheduling
 // =============================================================================
 
 /**
- * @brief Send a byte to mGB with proper inter-byte delay
+ * @brief Get the priority class of a remapped message
  */
-static void send_byte_to_mgb(uint8_t byte) {
-    // Wait for minimum inter-byte delay
-    int64_t elapsed_us = absolute_time_diff_us(s_last_byte_time, get_absolute_time());
-    if (elapsed_us < MGB_INTER_BYTE_DELAY_US) {
-        sleep_us(MGB_INTER_BYTE_DELAY_US - elapsed_us);
+static mgb_class_t class_of(const uint8_t *bytes) {
+    switch (bytes[0] & 0xF0) {
+        case 0x80:  // Note off
+        case 0x90:  // Note on
+            return MGB_CLASS_NOTE;
+        case 0xC0:  // Program change
+            return MGB_CLASS_PROGRAM;
+        default:    // Control change, pitch bend, pressure
+            return MGB_CLASS_CONTROLLER;
     }
+}
+
+/**
+ * @brief Pick the class whose next message a port sends
+ * 
+ * The highest class with messages waiting, unless a lower class's oldest
+ * message has waited MGB_STARVATION_BOUND_US; then the class that has
+ * waited longest goes first.
+ * 
+ * @return Class index, or MGB_CLASS_COUNT if nothing is queued
+ */
+static uint8_t select_class(uint8_t port, uint32_t now) {
+    uint8_t first = MGB_CLASS_COUNT;
+    uint8_t starved = MGB_CLASS_COUNT;
+    uint32_t starved_age = 0;
     
-    // Send the byte
-    gb_link_send_byte_blocking(byte);
-    s_last_byte_time = get_absolute_time();
+    for (uint8_t cls = 0; cls < MGB_CLASS_COUNT; cls++) {
+        uint16_t tail = s_out_tail[port][cls];
+        if (tail == s_out_head[port][cls]) {
+            continue;
+        }
+        if (first == MGB_CLASS_COUNT) {
+            first = cls;
+        }
+        
+        uint32_t age = now - s_out_queue[port][cls][tail].queued_us;
+        if (age >= MGB_STARVATION_BOUND_US && age > starved_age) {
+            starved = cls;
+            starved_age = age;
+        }
+    }
+    
+    return (starved != MGB_CLASS_COUNT) ? starved : first;
 }
 
 /**
- * @brief Forward a MIDI message to mGB with channel remapping
+ * @brief Account the queueing delay of a message handed to the link
  */
-static void forward_message_to_mgb(const midi_message_t *msg) {
-    // Get the mapped mGB channel
-    uint8_t midi_channel = msg->channel;
-    uint8_t mgb_channel = s_config.midi_to_mgb_channel[midi_channel];
+static void record_queue_delay(uint8_t cls, uint32_t delay_us) {
+    s_delay_count[cls]++;
+    s_delay_total_us[cls] += delay_us;
+    s_delay_last_us[cls] = delay_us;
+    if (delay_us > s_delay_max_us[cls]) {
+        s_delay_max_us[cls] = delay_us;
+    }
+}
+
+/**
+ * @brief Record the input-to-link latency of a message handed to the link
+ */
+static void record_latency(uint32_t latency_us) {
+    s_latency_last_us = latency_us;
+    if (latency_us > s_latency_max_us) {
+        s_latency_max_us = latency_us;
+    }
+}
+
+/**
+ * @brief Decide whether a message can go without its status byte
+ * 
+ * @return Bytes to skip at the start of the message (0 or 1)
+ */
+static uint8_t running_status_skip(uint8_t port, const uint8_t *bytes, uint32_t now) {
+    if (!s_config.running_status[port] || bytes[0] != s_rs_status[port]) {
+        return 0;
+    }
     
-    // Check if this channel is mapped and enabled
-    if (mgb_channel >= MGB_CHANNEL_COUNT) {
-        return;  // Channel not mapped
+    // Periodic refresh, and after a quiet link the target may have reset
+    if (s_config.running_status_refresh != 0 &&
+        s_rs_omitted[port] >= s_config.running_status_refresh) {
+        return 0;
     }
+    if (now - s_rs_last_us[port] >= MGB_RUNNING_STATUS_IDLE_US) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Update a port's running status after a message went to the link
+ */
+static void running_status_sent(uint8_t port, uint8_t status, uint8_t skip, uint32_t now) {
+    if (skip) {
+        s_rs_omitted[port]++;
+        s_rs_saved_count++;
+    } else {
+        s_rs_status[port] = status;
+        s_rs_omitted[port] = 0;
+    }
+    s_rs_last_us[port] = now;
+}
+
+/**
+ * @brief Hand the next message of each idle port to the GB link
+ * 
+ * A port only gets a message once everything released before has left
+ * its TX ring and PIO FIFO, so at most one message is ever committed to
+ * the link ahead of the byte being clocked out. The next one is picked
+ * while that byte is on the wire, so the link stays busy.
+ * Real-time bytes waiting for a port go before any message.
+ * 
+ * @return Microseconds until a port with messages left has drained the
+ *         link, 0 if every queue is empty
+ */
+static uint32_t release_messages(void) {
+    uint32_t retry_us = 0;
+    uint32_t now = timer_hw->timerawl;
     
-    if (!s_config.channel_enabled[mgb_channel]) {
-        return;  // Channel disabled
+    for (uint8_t port = 0; port < gb_link_get_port_count(); port++) {
+        uint8_t cls = select_class(port, now);
+        if (cls == MGB_CLASS_COUNT && s_rt_tail[port] == s_rt_head[port]) {
+            continue;
+        }
+        
+        uint16_t pending = gb_link_tx_pending(port);
+        if (pending == 0 && s_rt_tail[port] != s_rt_head[port]) {
+            // Real-time bytes go first, between messages
+            uint8_t tail = s_rt_tail[port];
+            if (gb_link_send_byte(port, s_rt_queue[port][tail])) {
+                s_rt_tail[port] = (tail + 1) & (MGB_RT_QUEUE_SIZE - 1);
+                pending = 1;
+            }
+        } else if (pending == 0) {
+            uint16_t tail = s_out_tail[port][cls];
+            const mgb_out_message_t *m = &s_out_queue[port][cls][tail];
+            uint8_t skip = running_status_skip(port, m->bytes, now);
+            if (gb_link_send_bytes(port, m->bytes + skip, m->length - skip)) {
+                running_status_sent(port, m->bytes[0], skip, now);
+                record_queue_delay(cls, now - m->queued_us);
+                record_latency(now - m->input_us);
+                s_out_tail[port][cls] = (tail + 1) & (MGB_OUT_QUEUE_SIZE - 1);
+                pending = m->length - skip;
+            }
+        }
+        
+        if (select_class(port, now) == MGB_CLASS_COUNT &&
+            s_rt_tail[port] == s_rt_head[port]) {
+            continue;
+        }
+        
+        // Each byte takes 8 bit times plus the gap; check again once the
+        // bytes still pending are out of the FIFO
+        uint32_t byte_us = 8000000u / gb_link_get_clock_hz(port)
+                           + gb_link_get_byte_gap_us(port);
+        uint32_t wait_us = (pending > 0 ? pending : 1) * byte_us;
+        if (retry_us == 0 || wait_us < retry_us) {
+            retry_us = wait_us;
+        }
     }
     
-    // Remap the status byte to the mGB channel
-    uint8_t status = (msg->raw[0] & 0xF0) | mgb_channel;
+    return retry_us;
+}
+
+/**
+ * @brief Release alarm: feed the link and re-arm while messages wait
+ */
+static void on_release_alarm(uint alarm_num) {
+    s_release_pending = false;
+    
+    uint32_t retry_us = release_messages();
+    if (retry_us == 0) {
+        return;
+    }
+    
+    s_release_pending = true;
+    if (hardware_alarm_set_target(alarm_num, make_timeout_time_us(retry_us))) {
+        hardware_alarm_force_irq(alarm_num);  // Already due
+    }
+}
+
+/**
+ * @brief Run the release alarm now unless it is already due
+ */
+static void schedule_release(void) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    if (!s_release_pending) {
+        s_release_pending = true;
+        hardware_alarm_force_irq((uint)s_release_alarm);
+    }
+    restore_interrupts(irq_state);
+}
+
+/**
+ * @brief Check whether a message only carries a controller's latest value
+ */
+static bool is_coalescable(const uint8_t *bytes) {
+    switch (bytes[0] & 0xF0) {
+        case 0xA0:  // Poly pressure
+        case 0xB0:  // Control change
+        case 0xD0:  // Channel pressure
+        case 0xE0:  // Pitch bend
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Find a queued, unsent message a new value would replace
+ * 
+ * Same status byte (type and channel) and, for control change and poly
+ * pressure, the same controller or note. Call with interrupts disabled
+ * so the release alarm cannot take the slot meanwhile.
+ * 
+ * @return The queued message, or NULL if there is none
+ */
+static mgb_out_message_t *find_coalesce_slot(uint8_t port, const uint8_t *bytes) {
+    uint8_t type = bytes[0] & 0xF0;
+    bool keyed = (type == 0xA0 || type == 0xB0);
+    
+    for (uint16_t i = s_out_tail[port][MGB_CLASS_CONTROLLER];
+         i != s_out_head[port][MGB_CLASS_CONTROLLER];
+         i = (i + 1) & (MGB_OUT_QUEUE_SIZE - 1)) {
+        mgb_out_message_t *m = &s_out_queue[port][MGB_CLASS_CONTROLLER][i];
+        if (m->bytes[0] == bytes[0] && (!keyed || m->bytes[1] == bytes[1])) {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Check whether a port's output queue can take a message
+ */
+static bool port_can_take(uint8_t port, const uint8_t *bytes) {
+    mgb_class_t cls = class_of(bytes);
+    uint16_t next = (s_out_head[port][cls] + 1) & (MGB_OUT_QUEUE_SIZE - 1);
+    if (next != s_out_tail[port][cls]) {
+        return true;
+    }
     
-    // Send the message bytes to mGB
+    // Full, but an update can still replace its queued predecessor
+    if (!is_coalescable(bytes)) {
+        return false;
+    }
+    uint32_t irq_state = save_and_disable_interrupts();
+    bool found = (find_coalesce_slot(port, bytes) != NULL);
+    restore_interrupts(irq_state);
+    return found;
+}
+
+#if DEBUG_ENABLED
+/**
+ * @brief Check that a controller update left no stale backlog behind
+ * 
+ * However fast a sweep comes in, each (channel, controller) may have at
+ * most one update waiting in the output queue, and the link may hold no
+ * more than the message being sent, since coalescing cannot reach bytes
+ * already in its ring. Counts violations in s_stale_update_count.
+ */
+static void check_update_backlog(uint8_t port, const uint8_t *bytes) {
+    uint8_t type = bytes[0] & 0xF0;
+    bool keyed = (type == 0xA0 || type == 0xB0);
+    uint16_t queued = 0;
+    
+    uint32_t irq_state = save_and_disable_interrupts();
+    for (uint16_t i = s_out_tail[port][MGB_CLASS_CONTROLLER];
+         i != s_out_head[port][MGB_CLASS_CONTROLLER];
+         i = (i + 1) & (MGB_OUT_QUEUE_SIZE - 1)) {
+        const mgb_out_message_t *m = &s_out_queue[port][MGB_CLASS_CONTROLLER][i];
+        if (m->bytes[0] == bytes[0] && (!keyed || m->bytes[1] == bytes[1])) {
+            queued++;
+        }
+    }
+    uint16_t in_link = gb_link_tx_pending(port);
+    restore_interrupts(irq_state);
+    
+    if (queued > 1 || in_link > 3) {
+        s_stale_update_count++;
+    }
+}
+#endif
+
+/**
+ * @brief Queue a complete message for mGB
+ * 
+ * Returns at once; the release alarm hands the message to the GB link,
+ * where DMA and the PIO program space the bytes out. A controller update
+ * replaces a queued one for the same controller instead.
+ * 
+ * @param input_us Arrival of the message's first MIDI byte, for the
+ *                 input-to-link latency
+ * @return false if the port's queue for the message's class is full
+ */
+static bool send_message_to_mgb(uint8_t port, const uint8_t *bytes, uint8_t length,
+                                uint32_t input_us) {
+    if (is_coalescable(bytes)) {
+        uint32_t irq_state = save_and_disable_interrupts();
+        mgb_out_message_t *m = find_coalesce_slot(port, bytes);
+        if (m != NULL) {
+            memcpy(m->bytes, bytes, length);
+            m->input_us = input_us;
+            s_coalesced_count++;
+        }
+        restore_interrupts(irq_state);
+        
+        if (m != NULL) {
+#if DEBUG_ENABLED
+            check_update_backlog(port, bytes);
+#endif
+            return true;
+        }
+    }
+    
+    mgb_class_t cls = class_of(bytes);
+    uint16_t head = s_out_head[port][cls];
+    uint16_t next = (head + 1) & (MGB_OUT_QUEUE_SIZE - 1);
+    if (next == s_out_tail[port][cls]) {
+        return false;
+    }
+    
+    mgb_out_message_t *m = &s_out_queue[port][cls][head];
+    memcpy(m->bytes, bytes, length);
+    m->length = length;
+    m->queued_us = timer_hw->timerawl;
+    m->input_us = input_us;
+    __dmb();
+    s_out_head[port][cls] = next;
+
+#if DEBUG_ENABLED
+    if (cls == MGB_CLASS_CONTROLLER) {
+        check_update_backlog(port, bytes);
+    }
+#endif
+    
+    schedule_release();
+    return true;
+}
+
+/**
+ * @brief Drop everything waiting in the output queues
+ */
+static void clear_output_queues(void) {
+    memset((void *)s_out_head, 0, sizeof(s_out_head));
+    memset((void *)s_out_tail, 0, sizeof(s_out_tail));
+    memset((void *)s_rt_head, 0, sizeof(s_rt_head));
+    memset((void *)s_rt_tail, 0, sizeof(s_rt_tail));
+}
+
+/**
+ * @brief Queue a real-time byte for every port that forwards them
+ * 
+ * Called from the RX interrupts and the main loop, so the queues are
+ * filled with interrupts disabled. A byte for a full queue is dropped.
+ */
+static void forward_realtime(uint8_t byte) {
+    bool queued = false;
+    
+    uint32_t irq_state = save_and_disable_interrupts();
+    for (uint8_t port = 0; port < gb_link_get_port_count(); port++) {
+        if (!s_config.forward_realtime[port]) {
+            continue;
+        }
+        
+        uint8_t head = s_rt_head[port];
+        uint8_t next = (head + 1) & (MGB_RT_QUEUE_SIZE - 1);
+        if (next == s_rt_tail[port]) {
+            s_drop_count++;
+            continue;
+        }
+        s_rt_queue[port][head] = byte;
+        s_rt_head[port] = next;
+        queued = true;
+    }
+    restore_interrupts(irq_state);
+    
+    if (queued) {
+        schedule_release();
+    }
+}
+
+// =============================================================================
+// MIDI Message Handling
+// =============================================================================
+
+
+/**
+ * @brief Get the length of a message as sent to mGB
+ * 
+ * @return Length in bytes, 0 for messages mGB does not get
+ */
+static uint8_t mgb_message_length(const midi_message_t *msg) {
     switch (msg->type) {
         case MIDI_MSG_NOTE_OFF:
         case MIDI_MSG_NOTE_ON:
         case MIDI_MSG_POLY_PRESSURE:
         case MIDI_MSG_CONTROL_CHANGE:
         case MIDI_MSG_PITCH_BEND:
-            // 3-byte messages
-            send_byte_to_mgb(status);
-            send_byte_to_mgb(msg->data1);
-            send_byte_to_mgb(msg->data2);
-            s_forward_count++;
-            led_trigger_activity();
-            break;
+            return 3;
             
         case MIDI_MSG_PROGRAM_CHANGE:
         case MIDI_MSG_CHANNEL_PRESSURE:
-            // 2-byte messages
-            send_byte_to_mgb(status);
-            send_byte_to_mgb(msg->data1);
-            s_forward_count++;
-            led_trigger_activity();
-            break;
+            return 2;
             
         default:
             // Other messages are not forwarded to mGB
+            return 0;
+    }
+}
+
+/**
+ * @brief Remap a message for one link port
+ * 
+ * Uses the port's mapping (port 0's in broadcast routing).
+ * 
+ * @param bytes Where to store the message with the mGB channel
+ * @return false if the channel is not mapped or disabled on this port
+ */
+static bool map_message_to_port(const midi_message_t *msg, uint8_t port, uint8_t bytes[3]) {
+    // Get the mapped mGB channel
+    uint8_t map_port = (s_config.routing == MGB_ROUTING_BROADCAST) ? 0 : port;
+    uint8_t mgb_channel = s_config.midi_to_mgb_channel[map_port][msg->channel];
+    
+    // Check if this channel is mapped and enabled
+    if (mgb_channel >= MGB_CHANNEL_COUNT) {
+        return false;  // Channel not mapped
+    }
+    
+    if (!s_config.channel_enabled[mgb_channel]) {
+        return false;  // Channel disabled
+    }
+    
+    // Remap the status byte to the mGB channel
+    bytes[0] = (uint8_t)((msg->raw[0] & 0xF0) | mgb_channel);
+    bytes[1] = msg->data1;
+    bytes[2] = msg->data2;
+    return true;
+}
+
+/**
+ * @brief Forward a MIDI message to mGB with channel remapping
+ * 
+ * Goes to every link port whose mapping assigns the message's channel to
+ * an enabled mGB channel.
+ */
+static void forward_message_to_mgb(const midi_message_t *msg, mgb_source_t source) {
+    uint8_t length = mgb_message_length(msg);
+    if (length == 0) {
+        return;
+    }
+    
+    bool forwarded = false;
+    
+    for (uint8_t port = 0; port < gb_link_get_port_count(); port++) {
+        uint8_t bytes[3];
+        if (!map_message_to_port(msg, port, bytes)) {
+            continue;
+        }
+        
+        if (send_message_to_mgb(port, bytes, length, msg->timestamp_us)) {
+            forwarded = true;
+        } else {
+            s_drop_count++;
+            s_source_drop_count[source]++;
+        }
+    }
+    
+    if (forwarded) {
+        s_forward_count++;
+        s_source_forward_count[source]++;
+        led_trigger_activity();
+    }
+}
+
+// =============================================================================
+// DIN/USB Merge
+// =============================================================================
+
+/**
+ * @brief Check whether a message is one mGB plays (channel voice)
+ */
+static bool is_mgb_message(const midi_message_t *msg) {
+    return msg->type >= MIDI_MSG_NOTE_OFF && msg->type <= MIDI_MSG_PITCH_BEND;
+}
+
+/**
+ * @brief Queue a message from a source for the merge, dropping it if full
+ */
+static void source_push(mgb_source_t source, const midi_message_t *msg) {
+    uint16_t head = s_source_head[source];
+    uint16_t next = (head + 1) & (MGB_SOURCE_QUEUE_SIZE - 1);
+    if (next == s_source_tail[source]) {
+        s_drop_count++;
+        s_source_drop_count[source]++;
+        return;
+    }
+    
+    s_source_queue[source][head] = *msg;
+    s_source_head[source] = next;
+}
+
+/**
+ * @brief Check that every port the message goes to can take it now
+ */
+static bool output_can_take(const midi_message_t *msg) {
+    for (uint8_t port = 0; port < gb_link_get_port_count(); port++) {
+        uint8_t bytes[3];
+        if (map_message_to_port(msg, port, bytes) && !port_can_take(port, bytes)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Move waiting messages to the output queues, alternating sources
+ * 
+ * A source whose next message the output queues cannot take yet is
+ * skipped, so what the link cannot take stays in the source queues (and
+ * that source still goes first once room frees up), while controller
+ * updates that coalesce into queued ones keep flowing.
+ */
+static void merge_sources(void) {
+    while (true) {
+        bool found = false;
+        
+        for (uint8_t i = 0; i < MGB_SOURCE_COUNT; i++) {
+            uint8_t source = (s_merge_next + i) % MGB_SOURCE_COUNT;
+            uint16_t tail = s_source_tail[source];
+            if (tail == s_source_head[source] ||
+                !output_can_take(&s_source_queue[source][tail])) {
+                continue;
+            }
+            
+            forward_message_to_mgb(&s_source_queue[source][tail], (mgb_source_t)source);
+            s_source_tail[source] = (tail + 1) & (MGB_SOURCE_QUEUE_SIZE - 1);
+            s_merge_next = (source + 1) % MGB_SOURCE_COUNT;
+            found = true;
+            break;
+        }
+        
+        if (!found) {
             break;
+        }
     }
 }
 
 /**
- * @brief MIDI message callback (called from UART interrupt context)
+ * @brief Empty the source queues and reset the merge
+ */
+static void clear_source_queues(void) {
+    for (uint8_t source = 0; source < MGB_SOURCE_COUNT; source++) {
+        s_source_head[source] = 0;
+        s_source_tail[source] = 0;
+    }
+    s_merge_next = 0;
+}
+
+// =============================================================================
+// DIN to USB Thru
+// =============================================================================
+
+/**
+ * @brief Queue DIN traffic for the USB host
  * 
- * Also forwards DIN MIDI to USB for thru/merge functionality
+ * Callbacks of different RX interrupts may push, so the slot is taken
+ * with interrupts disabled. Dropped when the queue is full.
  */
-static void on_midi_message(const midi_message_t *msg) {
-    // Forward DIN MIDI to USB (MIDI merge/thru)
-    usb_midi_send_message(msg);
+static void thru_push(const midi_message_t *msg, bool sysex, bool end) {
+    uint32_t irq_state = save_and_disable_interrupts();
     
-    // The main loop will poll and process messages for GB forwarding
+    uint16_t head = s_thru_head;
+    uint16_t next = (head + 1) & (MGB_USB_THRU_QUEUE_SIZE - 1);
+    if (next != s_thru_tail) {
+        mgb_thru_entry_t *e = &s_thru_queue[head];
+        e->msg = *msg;
+        e->sysex = sysex;
+        e->end = end;
+        s_thru_head = next;
+    }
+    
+    restore_interrupts(irq_state);
+}
+
+/**
+ * @brief Send queued DIN traffic to the USB host while its FIFO has room
+ * 
+ * Called from the main loop only. Entries that do not fit stay queued
+ * for the next pass.
+ */
+static void thru_drain(void) {
+    // A trace dump holds the USB stream until its SysEx is complete
+    if (s_dump_pos != s_dump_len) {
+        return;
+    }
+    
+    while (s_thru_tail != s_thru_head) {
+        const mgb_thru_entry_t *e = &s_thru_queue[s_thru_tail];
+        bool sent = e->sysex
+                    ? usb_midi_try_send_sysex(e->msg.raw, e->msg.length, e->end)
+                    : usb_midi_try_send_message(&e->msg);
+        if (!sent) {
+            break;
+        }
+        if (e->sysex) {
+            s_thru_in_sysex = !e->end;
+        }
+        s_thru_tail = (s_thru_tail + 1) & (MGB_USB_THRU_QUEUE_SIZE - 1);
+    }
+}
+
+/**
+ * @brief Drop DIN traffic not yet sent to USB
+ */
+static void clear_thru_queue(void) {
+    s_thru_head = 0;
+    s_thru_tail = 0;
+    s_thru_in_sysex = false;
+}
+
+// =============================================================================
+// Input Callbacks
+// =============================================================================
+
+/**
+ * @brief MIDI message callback
+ * 
+ * Runs in midi_uart_process(), or in the RX interrupts with
+ * MIDI_RX_PARSE_IN_ISR. Queues DIN MIDI for USB (thru/merge); the main
+ * loop polls the messages for GB forwarding.
+ */
+static void on_midi_message(const midi_message_t *msg) {
+    thru_push(msg, false, false);
+}
+
+/**
+ * @brief Real-time byte callback
+ * 
+ * Runs in the RX interrupt as the byte arrives (from midi_uart_process()
+ * with the DMA backend), so clock reaches the link without waiting for
+ * the main loop.
+ */
+static void on_midi_realtime(uint8_t byte, uint32_t timestamp_us) {
+    (void)timestamp_us;
+    forward_realtime(byte);
+}
+
+/**
+ * @brief SysEx chunk callback
+ * 
+ * Streams DIN SysEx (patch dumps etc.) through to USB by way of the thru
+ * queue. Same context as on_midi_message().
+ */
+static void on_midi_sysex(const uint8_t *bytes, uint8_t length, bool end) {
+    midi_message_t chunk = { .length = length };
+    memcpy(chunk.raw, bytes, length);
+    thru_push(&chunk, true, end);
+}
+
+/**
+ * @brief Look for the trace request in SysEx bytes from USB
+ */
+static void watch_usb_sysex(const midi_message_t *msg) {
+    for (uint8_t i = 0; i < msg->length; i++) {
+        uint8_t byte = msg->raw[i];
+        
+        if (byte == 0xF0) {
+            s_usb_sysex_len = 0;
+        } else if (s_usb_sysex_len == SYSEX_IDLE) {
+            continue;
+        } else if (byte == 0xF7) {
+            if (s_usb_sysex_len == 3 && s_usb_sysex[0] == MGB_SYSEX_ID &&
+                s_usb_sysex[1] == MGB_SYSEX_TRACE_REQUEST) {
+                mode_mgb_dump_link_trace(s_usb_sysex[2]);
+            }
+            s_usb_sysex_len = SYSEX_IDLE;
+        } else if ((byte & 0x80) || s_usb_sysex_len >= sizeof(s_usb_sysex)) {
+            s_usb_sysex_len = SYSEX_IDLE;  // Another message, or not ours
+        } else {
+            s_usb_sysex[s_usb_sysex_len++] = byte;
+        }
+    }
 }
 
 /**
  * @brief USB MIDI message callback
  * 
- * Receives MIDI from USB host and forwards to GB
+ * Receives MIDI from USB host, forwards it to DIN MIDI OUT and queues
+ * channel voice messages for the Game Boys
  */
 static void on_usb_midi_message(const midi_message_t *msg) {
-    // USB → GB forwarding happens in the main process loop
-    // This just serves as a notification (message is queued in usb_midi module)
-    (void)msg;
+    // USB → DIN (SysEx packets carry raw bytes and pass through as-is)
+    midi_uart_send_raw(msg->raw, msg->length);
+    
+    // USB → GB, merged with DIN in mode_mgb_process()
+    if (is_mgb_message(msg)) {
+        source_push(MGB_SOURCE_USB, msg);
+    } else if (msg->length == 1 && midi_codec_is_realtime(msg->raw[0])) {
+        forward_realtime(msg->raw[0]);
+    }
+    
+    if (msg->raw[0] == 0xF0 || s_usb_sysex_len != SYSEX_IDLE) {
+        watch_usb_sysex(msg);
+    }
+}
+
+// =============================================================================
+// Link Trace Dump
+// =============================================================================
+
+/**
+ * @brief Get a byte of the SysEx dump
+ * 
+ * The dump is generated as it is sent, so only the trace copy is kept:
+ * header, then per entry the data (2 groups), queued and wire times
+ * (5 groups each) as 7-bit groups LSB first, then 0xF7.
+ */
+static uint8_t dump_byte(uint32_t pos) {
+    if (pos < DUMP_HEADER_BYTES) {
+        return s_dump_header[pos];
+    }
+    pos -= DUMP_HEADER_BYTES;
+    if (pos >= s_dump_len - DUMP_HEADER_BYTES - 1) {
+        return 0xF7;
+    }
+
+#if GB_LINK_TRACE
+    const gb_link_trace_entry_t *e = &s_trace_copy[pos / DUMP_ENTRY_BYTES];
+    uint32_t field = pos % DUMP_ENTRY_BYTES;
+    uint32_t value;
+    if (field < 2) {
+        value = e->data;
+    } else if (field < 7) {
+        value = e->queued_us;
+        field -= 2;
+    } else {
+        value = e->wire_us;
+        field -= 7;
+    }
+    return (uint8_t)((value >> (7 * field)) & 0x7F);
+#else
+    return 0xF7;
+#endif
+}
+
+/**
+ * @brief Send as much of the trace dump as the USB FIFO takes
+ * 
+ * Called every main loop pass; never waits for the FIFO.
+ */
+static void dump_service(void) {
+    // Don't cut into a DIN SysEx already on its way to the host
+    if (s_dump_pos == 0 && s_thru_in_sysex) {
+        return;
+    }
+    
+    while (s_dump_pos < s_dump_len) {
+        uint8_t chunk[3];
+        uint32_t left = s_dump_len - s_dump_pos;
+        uint8_t length = (left < sizeof(chunk)) ? (uint8_t)left : sizeof(chunk);
+        for (uint8_t i = 0; i < length; i++) {
+            chunk[i] = dump_byte(s_dump_pos + i);
+        }
+        
+        if (!usb_midi_try_send_sysex(chunk, length, length == left)) {
+            break;  // FIFO full or host gone; carry on next pass
+        }
+        s_dump_pos += length;
+    }
 }
 
 // =============================================================================
@@ -182,16 +1044,45 @@ bool mode_mgb_init(void) {
         return false;
     }
     
+    // Hardware alarm that feeds the output queues to the link
+    s_release_alarm = hardware_alarm_claim_unused(false);
+    if (s_release_alarm < 0) {
+        DEBUG_PRINT("mGB: No hardware alarm for output scheduling\\n");
+        midi_uart_deinit();
+        gb_link_deinit();
+        return false;
+    }
+    clear_output_queues();
+    clear_source_queues();
+    clear_thru_queue();
+    s_dump_len = 0;
+    s_dump_pos = 0;
+    s_release_pending = false;
+    hardware_alarm_set_callback((uint)s_release_alarm, on_release_alarm);
+    
     // Set up callbacks
     midi_uart_set_message_callback(on_midi_message);
+    midi_uart_set_sysex_callback(on_midi_sysex);
+    midi_uart_set_realtime_callback(on_midi_realtime);
     usb_midi_set_rx_callback(on_usb_midi_message);
     
-    // Reset timing
-    s_last_byte_time = get_absolute_time();
+    // Clock and pace bytes for mGB in the PIO program
+    apply_link_config();
     
     // Reset statistics
     s_forward_count = 0;
     s_drop_count = 0;
+    s_coalesced_count = 0;
+    s_stale_update_count = 0;
+    s_rs_saved_count = 0;
+    memset(s_delay_count, 0, sizeof(s_delay_count));
+    memset(s_delay_total_us, 0, sizeof(s_delay_total_us));
+    memset(s_delay_last_us, 0, sizeof(s_delay_last_us));
+    memset(s_delay_max_us, 0, sizeof(s_delay_max_us));
+    memset(s_source_forward_count, 0, sizeof(s_source_forward_count));
+    memset(s_source_drop_count, 0, sizeof(s_source_drop_count));
+    s_latency_last_us = 0;
+    s_latency_max_us = 0;
     
     s_active = true;
     
@@ -209,8 +1100,17 @@ void mode_mgb_deinit(void) {
     
     // Clear callbacks
     midi_uart_set_message_callback(NULL);
+    midi_uart_set_sysex_callback(NULL);
+    midi_uart_set_realtime_callback(NULL);
     usb_midi_set_rx_callback(NULL);
     
+    // Stop the output scheduling; queued messages are dropped
+    hardware_alarm_cancel((uint)s_release_alarm);
+    hardware_alarm_set_callback((uint)s_release_alarm, NULL);
+    hardware_alarm_unclaim((uint)s_release_alarm);
+    s_release_alarm = -1;
+    clear_output_queues();
+    
     // Deinitialize subsystems
     midi_uart_deinit();
     gb_link_deinit();
@@ -227,11 +1127,19 @@ const mode_mgb_config_t* mode_mgb_get_config(void) {
 void mode_mgb_set_config(const mode_mgb_config_t *config) {
     if (config != NULL) {
         memcpy(&s_config, config, sizeof(mode_mgb_config_t));
+        
+        if (s_active) {
+            apply_link_config();
+        }
     }
 }
 
 void mode_mgb_reset_config(void) {
     apply_default_config();
+    
+    if (s_active) {
+        apply_link_config();
+    }
 }
 
 // =============================================================================
@@ -246,17 +1154,25 @@ void mode_mgb_process(void) {
     // Process MIDI input from DIN (runs the parser)
     midi_uart_process();
     
+    // DIN → USB thru, queued by the midi_uart callbacks
+    thru_drain();
+    
     // Process USB MIDI input
     usb_midi_process_rx();
     
-    // Forward DIN MIDI messages to Game Boy
+    // Queue DIN MIDI messages for the Game Boy (channel voice only)
     midi_message_t msg;
     while (midi_uart_get_message(&msg)) {
-        // Only forward channel voice messages
-        if (msg.type >= MIDI_MSG_NOTE_OFF && msg.type <= MIDI_MSG_PITCH_BEND) {
-            forward_message_to_mgb(&msg);
+        if (is_mgb_message(&msg)) {
+            source_push(MGB_SOURCE_DIN, &msg);
         }
     }
+    
+    // Merge DIN and USB into the output queues
+    merge_sources();
+    
+    // Continue a trace dump requested over USB
+    dump_service();
 }
 
 bool mode_mgb_is_active(void) {
@@ -275,7 +1191,88 @@ uint32_t mode_mgb_get_drop_count(void) {
     return s_drop_count;
 }
 
+uint32_t mode_mgb_get_source_forward_count(mgb_source_t source) {
+    return (source < MGB_SOURCE_COUNT) ? s_source_forward_count[source] : 0;
+}
+
+uint32_t mode_mgb_get_source_drop_count(mgb_source_t source) {
+    return (source < MGB_SOURCE_COUNT) ? s_source_drop_count[source] : 0;
+}
+
+uint32_t mode_mgb_get_coalesced_count(void) {
+    return s_coalesced_count;
+}
+
+uint32_t mode_mgb_get_stale_update_count(void) {
+    return s_stale_update_count;
+}
+
+uint32_t mode_mgb_get_running_status_saved_count(void) {
+    return s_rs_saved_count;
+}
+
+void mode_mgb_get_queue_delay(mgb_class_t cls, mgb_queue_delay_t *delay) {
+    if (delay == NULL) {
+        return;
+    }
+    if (cls >= MGB_CLASS_COUNT) {
+        memset(delay, 0, sizeof(*delay));
+        return;
+    }
+    
+    delay->count = s_delay_count[cls];
+    delay->last_us = s_delay_last_us[cls];
+    delay->max_us = s_delay_max_us[cls];
+    delay->avg_us = s_delay_count[cls]
+                    ? (uint32_t)(s_delay_total_us[cls] / s_delay_count[cls]) : 0;
+}
+
+uint32_t mode_mgb_get_latency_last_us(void) {
+    return s_latency_last_us;
+}
+
+uint32_t mode_mgb_get_latency_max_us(void) {
+    return s_latency_max_us;
+}
+
 void mode_mgb_reset_stats(void) {
     s_forward_count = 0;
     s_drop_count = 0;
+    s_coalesced_count = 0;
+    s_stale_update_count = 0;
+    s_rs_saved_count = 0;
+    memset(s_delay_count, 0, sizeof(s_delay_count));
+    memset(s_delay_total_us, 0, sizeof(s_delay_total_us));
+    memset(s_delay_last_us, 0, sizeof(s_delay_last_us));
+    memset(s_delay_max_us, 0, sizeof(s_delay_max_us));
+    memset(s_source_forward_count, 0, sizeof(s_source_forward_count));
+    memset(s_source_drop_count, 0, sizeof(s_source_drop_count));
+    s_latency_last_us = 0;
+    s_latency_max_us = 0;
+}
+
+// =============================================================================
+// Public Functions - Diagnostics
+// =============================================================================
+
+bool mode_mgb_dump_link_trace(uint8_t port) {
+    if (s_dump_pos != s_dump_len) {
+        return false;  // Cannot start another SysEx inside this one
+    }
+    
+    uint16_t count = 0;
+#if GB_LINK_TRACE
+    count = gb_link_trace_read(port, s_trace_copy, GB_LINK_TRACE_SIZE);
+#endif
+    
+    s_dump_header[0] = 0xF0;
+    s_dump_header[1] = MGB_SYSEX_ID;
+    s_dump_header[2] = MGB_SYSEX_TRACE_DUMP;
+    s_dump_header[3] = port & 0x7F;
+    s_dump_header[4] = count & 0x7F;
+    s_dump_header[5] = (count >> 7) & 0x7F;
+    
+    s_dump_len = DUMP_HEADER_BYTES + (uint32_t)count * DUMP_ENTRY_BYTES + 1;
+    s_dump_pos = 0;
+    return true;
 }
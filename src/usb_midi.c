@@ -7,9 +7,11 @@
  */
 
 #include "usb_midi.h"
+#include "midi_codec.h"
 #include "config.h"
 
 #include "tusb.h"
+#include "hardware/timer.h"
 #include "pico/stdlib.h"
 
 #include <string.h>
@@ -23,6 +25,7 @@ static midi_message_callback_t s_rx_callback = NULL;
 // Statistics
 static volatile uint32_t s_rx_count = 0;
 static volatile uint32_t s_tx_count = 0;
+static volatile uint32_t s_tx_drop_count = 0;
 
 static bool s_initialized = false;
 
@@ -30,39 +33,6 @@ static bool s_initialized = false;
 // Helper Functions
 // =============================================================================
 
-/**
- * @brief Get message type from status byte
- */
-static midi_message_type_t get_message_type(uint8_t status) {
-    switch (status & 0xF0) {
-        case 0x80: return MIDI_MSG_NOTE_OFF;
-        case 0x90: return MIDI_MSG_NOTE_ON;
-        case 0xA0: return MIDI_MSG_POLY_PRESSURE;
-        case 0xB0: return MIDI_MSG_CONTROL_CHANGE;
-        case 0xC0: return MIDI_MSG_PROGRAM_CHANGE;
-        case 0xD0: return MIDI_MSG_CHANNEL_PRESSURE;
-        case 0xE0: return MIDI_MSG_PITCH_BEND;
-        case 0xF0:
-            switch (status) {
-                case 0xF0: return MIDI_MSG_SYSEX_START;
-                case 0xF1: return MIDI_MSG_MTC_QUARTER;
-                case 0xF2: return MIDI_MSG_SONG_POSITION;
-                case 0xF3: return MIDI_MSG_SONG_SELECT;
-                case 0xF6: return MIDI_MSG_TUNE_REQUEST;
-                case 0xF7: return MIDI_MSG_SYSEX_END;
-                case 0xF8: return MIDI_MSG_CLOCK;
-                case 0xFA: return MIDI_MSG_START;
-                case 0xFB: return MIDI_MSG_CONTINUE;
-                case 0xFC: return MIDI_MSG_STOP;
-                case 0xFE: return MIDI_MSG_ACTIVE_SENSING;
-                case 0xFF: return MIDI_MSG_SYSTEM_RESET;
-                default:   return MIDI_MSG_NONE;
-            }
-        default:
-            return MIDI_MSG_NONE;
-    }
-}
-
 /**
  * @brief Parse USB-MIDI packet into midi_message_t
  */
@@ -77,79 +47,13 @@ static void parse_usb_midi_packet(uint8_t const packet[4], midi_message_t *msg)
     msg->raw[1] = packet[2];
     msg->raw[2] = packet[3];
     
-    // Determine message type and length based on code index
-    switch (code_index) {
-        case 0x02: // Two-byte System Common
-        case 0x06: // System Common (1 byte)
-        case 0x0C: // Program Change
-        case 0x0D: // Channel Pressure
-            msg->length = 2;
-            msg->type = get_message_type(msg->raw[0]);
-            msg->channel = msg->raw[0] & 0x0F;
-            msg->data1 = msg->raw[1];
-            msg->data2 = 0;
-            break;
-            
-        case 0x03: // Three-byte System Common
-        case 0x08: // Note Off
-        case 0x09: // Note On
-        case 0x0A: // Poly Pressure
-        case 0x0B: // Control Change
-        case 0x0E: // Pitch Bend
-            msg->length = 3;
-            msg->type = get_message_type(msg->raw[0]);
-            msg->channel = msg->raw[0] & 0x0F;
-            msg->data1 = msg->raw[1];
-            msg->data2 = msg->raw[2];
-            break;
-            
-        case 0x05: // Single-byte System Common
-        case 0x0F: // Single byte (Real-time)
-            msg->length = 1;
-            msg->type = get_message_type(msg->raw[0]);
-            msg->channel = 0;
-            msg->data1 = 0;
-            msg->data2 = 0;
-            break;
-            
-        default:
-            msg->length = 0;
-            msg->type = MIDI_MSG_NONE;
-            break;
-    }
-}
-
-/**
- * @brief Get USB-MIDI code index for a MIDI message
- */
-static uint8_t get_usb_midi_code_index(const midi_message_t *msg) {
-    switch (msg->type) {
-        case MIDI_MSG_NOTE_OFF:         return 0x08;
-        case MIDI_MSG_NOTE_ON:          return 0x09;
-        case MIDI_MSG_POLY_PRESSURE:    return 0x0A;
-        case MIDI_MSG_CONTROL_CHANGE:   return 0x0B;
-        case MIDI_MSG_PROGRAM_CHANGE:   return 0x0C;
-        case MIDI_MSG_CHANNEL_PRESSURE: return 0x0D;
-        case MIDI_MSG_PITCH_BEND:       return 0x0E;
-        
-        // System messages
-        case MIDI_MSG_SYSEX_START:      return 0x04;
-        case MIDI_MSG_SYSEX_END:        return 0x05;
-        case MIDI_MSG_MTC_QUARTER:      return 0x02;
-        case MIDI_MSG_SONG_POSITION:    return 0x03;
-        case MIDI_MSG_SONG_SELECT:      return 0x02;
-        case MIDI_MSG_TUNE_REQUEST:     return 0x05;
-        
-        // Real-time messages
-        case MIDI_MSG_CLOCK:            return 0x0F;
-        case MIDI_MSG_START:            return 0x0F;
-        case MIDI_MSG_CONTINUE:         return 0x0F;
-        case MIDI_MSG_STOP:             return 0x0F;
-        case MIDI_MSG_ACTIVE_SENSING:   return 0x0F;
-        case MIDI_MSG_SYSTEM_RESET:     return 0x0F;
-        
-        default:                        return 0x00;
-    }
+    // Length comes from the code index, type from the status byte
+    msg->length = midi_usb_cin_length[code_index];
+    msg->type = (msg->length > 0) ? midi_codec_get_type(msg->raw[0]) : MIDI_MSG_NONE;
+    msg->channel = (msg->length > 1) ? (msg->raw[0] & 0x0F) : 0;
+    msg->data1 = (msg->length > 1) ? msg->raw[1] : 0;
+    msg->data2 = (msg->length > 2) ? msg->raw[2] : 0;
+    msg->port = 0;
 }
 
 // =============================================================================
@@ -166,6 +70,7 @@ bool usb_midi_init(void) {
     s_rx_callback = NULL;
     s_rx_count = 0;
     s_tx_count = 0;
+    s_tx_drop_count = 0;
     s_initialized = true;
     
     DEBUG_PRINT("USB-MIDI: Initialized (waiting for host)\n");
@@ -186,12 +91,14 @@ void usb_midi_process_rx(void) {
     uint8_t packet[4];
     while (tud_midi_available()) {
         if (tud_midi_packet_read(packet)) {
+            uint32_t now = timer_hw->timerawl;
             s_rx_count++;
             
             // Parse and dispatch the message
             if (s_rx_callback != NULL) {
                 midi_message_t msg;
                 parse_usb_midi_packet(packet, &msg);
+                msg.timestamp_us = now;
                 
                 if (msg.length > 0) {
                     s_rx_callback(&msg);
@@ -205,26 +112,102 @@ void usb_midi_set_rx_callback(midi_message_callback_t callback) {
     s_rx_callback = callback;
 }
 
-bool usb_midi_send_message(const midi_message_t *msg) {
-    if (!s_initialized || !tud_mounted() || msg == NULL || msg->length == 0) {
+/**
+ * @brief Build the USB-MIDI packet for a message
+ * 
+ * @return false if there is nothing to send
+ */
+static bool build_message_packet(const midi_message_t *msg, uint8_t packet[4]) {
+    if (msg == NULL || msg->length == 0) {
         return false;
     }
     
-    // Build USB-MIDI packet
-    uint8_t packet[4];
-    packet[0] = get_usb_midi_code_index(msg); // Cable 0 + Code Index
+    packet[0] = midi_codec_get_usb_cin(msg->raw[0]); // Cable 0 + Code Index
     packet[1] = msg->raw[0];
     packet[2] = (msg->length > 1) ? msg->raw[1] : 0;
     packet[3] = (msg->length > 2) ? msg->raw[2] : 0;
-    
+    return true;
+}
+
+/**
+ * @brief Write a packet to the USB FIFO
+ * 
+ * @param count_drop Count a full FIFO as a dropped packet
+ */
+static bool write_packet(const uint8_t packet[4], bool count_drop) {
     if (tud_midi_packet_write(packet)) {
         s_tx_count++;
         return true;
     }
     
+    if (count_drop) {
+        s_tx_drop_count++;
+    }
     return false;
 }
 
+bool usb_midi_send_message(const midi_message_t *msg) {
+    uint8_t packet[4];
+    if (!s_initialized || !tud_mounted() || !build_message_packet(msg, packet)) {
+        return false;
+    }
+    
+    return write_packet(packet, true);
+}
+
+bool usb_midi_try_send_message(const midi_message_t *msg) {
+    uint8_t packet[4];
+    if (!s_initialized || !tud_mounted() || !build_message_packet(msg, packet)) {
+        return false;
+    }
+    
+    return write_packet(packet, false);
+}
+
+/**
+ * @brief Build the USB-MIDI packet for a SysEx chunk
+ * 
+ * @return false if the chunk is invalid
+ */
+static bool build_sysex_packet(const uint8_t *bytes, uint8_t length, bool end,
+                               uint8_t packet[4]) {
+    if (bytes == NULL || length == 0 || length > 3) {
+        return false;
+    }
+    
+    // Only the final packet of a message may be short
+    if (!end && length != 3) {
+        return false;
+    }
+    
+    // CIN 0x4: starts/continues, 0x5/0x6/0x7: ends with 1/2/3 bytes
+    packet[0] = end ? (0x04 + length) : 0x04;
+    packet[1] = bytes[0];
+    packet[2] = (length > 1) ? bytes[1] : 0;
+    packet[3] = (length > 2) ? bytes[2] : 0;
+    return true;
+}
+
+bool usb_midi_send_sysex(const uint8_t *bytes, uint8_t length, bool end) {
+    uint8_t packet[4];
+    if (!s_initialized || !tud_mounted() ||
+        !build_sysex_packet(bytes, length, end, packet)) {
+        return false;
+    }
+    
+    return write_packet(packet, true);
+}
+
+bool usb_midi_try_send_sysex(const uint8_t *bytes, uint8_t length, bool end) {
+    uint8_t packet[4];
+    if (!s_initialized || !tud_mounted() ||
+        !build_sysex_packet(bytes, length, end, packet)) {
+        return false;
+    }
+    
+    return write_packet(packet, false);
+}
+
 bool usb_midi_send_raw(const uint8_t *bytes, uint8_t length) {
     if (!s_initialized || !tud_mounted() || bytes == NULL || length == 0 || length > 3) {
         return false;
@@ -236,10 +219,12 @@ bool usb_midi_send_raw(const uint8_t *bytes, uint8_t length) {
     msg.raw[1] = (length > 1) ? bytes[1] : 0;
     msg.raw[2] = (length > 2) ? bytes[2] : 0;
     msg.length = length;
-    msg.type = get_message_type(bytes[0]);
+    msg.type = midi_codec_get_type(bytes[0]);
     msg.channel = bytes[0] & 0x0F;
     msg.data1 = msg.raw[1];
     msg.data2 = msg.raw[2];
+    msg.port = 0;
+    msg.timestamp_us = timer_hw->timerawl;
     
     return usb_midi_send_message(&msg);
 }
@@ -252,7 +237,12 @@ uint32_t usb_midi_get_tx_count(void) {
     return s_tx_count;
 }
 
+uint32_t usb_midi_get_tx_drop_count(void) {
+    return s_tx_drop_count;
+}
+
 void usb_midi_reset_stats(void) {
     s_rx_count = 0;
     s_tx_count = 0;
+    s_tx_drop_count = 0;
 }